@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 
+#include "collision.h"
 #include "color.h"
 #include "list.h"
 #include "polygon.h"
@@ -55,6 +56,16 @@ void body_free(Body *body);
  */
 List *body_get_shape(Body *body);
 
+/**
+ * Gets the current shape of a body without copying it.
+ * The list belongs to the body: it must not be modified or freed, and it
+ * changes as the body moves.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the polygon describing the body's current position
+ */
+List *body_borrow_shape(Body *body);
+
 /**
  * Gets the current center of mass of a body.
  * While this could be calculated with polygon_centroid(), that becomes too slow
@@ -66,6 +77,15 @@ List *body_get_shape(Body *body);
  */
 Vector body_get_centroid(Body *body);
 
+/**
+ * Gets the radius of a body: the distance from its center of mass to its
+ * farthest vertex. Computed once, since bodies are rigid.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's radius
+ */
+double body_get_radius(Body *body);
+
 /**
  * Gets the current velocity of a body.
  *
@@ -98,6 +118,17 @@ RGBColor body_get_color(Body *body);
  */
 double body_get_orientation(Body *body);
 
+/**
+ * Gets a counter that changes whenever a body's motion is changed by
+ * anything other than body_tick() moving it along its velocity,
+ * e.g. body_set_velocity(), body_set_centroid(), or an applied impulse.
+ * Lets code that predicts a body's path tell when the prediction is stale.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return a value that is unchanged as long as the body's motion is
+ */
+size_t body_get_motion_version(Body *body);
+
 /**
  * Gets the information associated with a body.
  *
@@ -136,6 +167,14 @@ void body_set_velocity(Body *body, Vector v);
  */
 void body_set_rotation(Body *body, double angle, Vector point);
 
+/**
+ * Gets the total force applied to a body since it was last ticked.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the force that the next body_tick() will apply
+ */
+Vector body_get_force(Body *body);
+
 /**
  * Applies a force to a body over the current tick.
  * If multiple forces are applied in the same tick, they should be added.
@@ -163,6 +202,53 @@ void body_add_impulse(Body *body, Vector impulse);
  */
 void body_reset_impulse(Body *body);
 
+/**
+ * A buffer that records forces and impulses added to bodies
+ * instead of applying them immediately.
+ * Lets several threads evaluate force creators at once without writing to
+ * the same bodies; the recorded contributions are later applied in order.
+ */
+typedef struct body_accumulator BodyAccumulator;
+
+/**
+ * Allocates memory for an empty accumulator.
+ * Asserts that the required memory is allocated.
+ *
+ * @return a pointer to the newly allocated accumulator
+ */
+BodyAccumulator *body_accumulator_init(void);
+
+/**
+ * Releases the memory allocated for an accumulator.
+ *
+ * @param acc a pointer to an accumulator returned from body_accumulator_init()
+ */
+void body_accumulator_free(BodyAccumulator *acc);
+
+/**
+ * Redirects body_add_force() and body_add_impulse() calls made by the
+ * calling thread into the given accumulator, until body_accumulator_end().
+ * Other threads are unaffected.
+ *
+ * @param acc the accumulator to record into
+ */
+void body_accumulator_begin(BodyAccumulator *acc);
+
+/**
+ * Stops redirecting the calling thread's forces and impulses.
+ */
+void body_accumulator_end(void);
+
+/**
+ * Adds every recorded force and impulse to its body, in the order
+ * they were recorded, and empties the accumulator.
+ * Applying accumulators in a fixed order therefore gives the same
+ * floating-point sums as applying the contributions directly.
+ *
+ * @param acc the accumulator to apply
+ */
+void body_accumulator_apply(BodyAccumulator *acc);
+
 /**
  * Updates the body after a given time interval has elapsed.
  * Sets acceleration and velocity according to the forces and impulses
@@ -200,4 +286,43 @@ bool body_is_removed(Body *body);
  */
 bool body_is_stationary(Body *body);
 
+/**
+ * Sets whether collisions involving a body are detected.
+ * Bodies start out collidable. While a body isn't, collisions created with
+ * create_collision() never fire for it, though it still moves normally.
+ * Counts as a change to the body's motion (see body_get_motion_version()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param collidable whether the body's collisions should be detected
+ */
+void body_set_collidable(Body *body, bool collidable);
+
+/**
+ * Returns whether collisions involving a body are detected.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the value last passed to body_set_collidable(), or true
+ */
+bool body_is_collidable(Body *body);
+
+/**
+ * Makes a body collide as a half-plane instead of as its polygon: everything
+ * beyond the edge of its shape that faces the given direction. The body is
+ * still drawn as its polygon. Used for walls that balls must never get past.
+ * The half-plane moves with the body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param normal a unit vector pointing out of the half-plane
+ */
+void body_set_half_plane(Body *body, Vector normal);
+
+/**
+ * Returns whether a body collides as a half-plane, and if so, which.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param plane set to the body's half-plane, if it has one
+ * @return whether body_set_half_plane() was called on the body
+ */
+bool body_get_half_plane(Body *body, HalfPlane *plane);
+
 #endif // #ifndef __BODY_H__
@@ -0,0 +1,192 @@
+#ifndef __BREAKER_H__
+#define __BREAKER_H__
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "color.h"
+#include "list.h"
+#include "particles.h"
+#include "scene.h"
+
+#define WIDTH 100.0     // width of game screen
+#define HEIGHT 100.0
+#define WALL_WIDTH 3 * WIDTH
+
+#define BACKGROUND_COLOR ((RGBColor) {49.0 / 255, 56.0 / 255, 72.0 / 255})
+
+#define TRAJ_INCREMENT M_PI / 200 // Change in angle with arrow keys
+#define TRAJ_LIMIT M_PI / 20      // Limit angle trajectory can aim
+#define MAX_AIM (M_PI / 2 - TRAJ_LIMIT)   // Largest aim angle from vertical
+
+/**
+ * The kind of each body in a Swipe Brick Breaker scene.
+ * Scenes returned from breaker_init() are indexed by these types.
+ */
+typedef enum {
+    BALL,
+    TRAJ,
+    BRICK,
+    C_BALL,
+    C_LIFE,     // Collectible life
+    C_BOMB,     // Collectible bomb
+    LIFE,       // Already collected life (icon on the side)
+    WALL,
+    FLOOR,
+    MISC,       // All others
+    N_BODY_TYPES
+} BodyType;
+
+typedef struct brick_info {
+    size_t level;       // Maximum health of brick
+    size_t health;      // Current health of brick
+} BrickInfo;
+
+/**
+ * The info attached to every body in the game.
+ * aux holds per-type data, e.g. a BrickInfo for bricks.
+ */
+typedef struct body_info {
+    BodyType type;
+    void *aux;
+    FreeFunc aux_free;
+} BodyInfo;
+
+/**
+ * Frees a BodyInfo and its aux value.
+ *
+ * @param info a pointer to a BodyInfo
+ */
+void free_body_info(BodyInfo *info);
+
+/**
+ * Returns the type of a body created by the game.
+ *
+ * @param body a body whose info is a BodyInfo
+ * @return the body's type
+ */
+BodyType get_body_type(Body *body);
+
+/**
+ * Constructs a rectangle with the given dimensions centered at (0, 0).
+ *
+ * @param width the width of the rectangle
+ * @param height the height of the rectangle
+ * @return the list of the rectangle's vertices
+ */
+List *rect_init(double width, double height);
+
+/**
+ * Starts a new game: resets the game state and returns the scene for the
+ * first round. The game draws from rand(), so seed it with srand() first for
+ * a reproducible game. Only one game may be running at a time.
+ *
+ * @return the game's scene
+ */
+Scene *breaker_init(void);
+
+/**
+ * Starts a new game on an endless board: a fixed sequence of rows, determined
+ * by board_seed alone, that scroll onto the screen one per round. Unlike
+ * breaker_init(), every game on the same board meets the same rows however it
+ * is played. Only one game may be running at a time.
+ *
+ * @param board_seed the seed the board's rows are drawn from
+ * @return the game's scene
+ */
+Scene *breaker_init_endless(unsigned int board_seed);
+
+/**
+ * Ends the game and frees its scene.
+ *
+ * @param s the scene returned from breaker_init()
+ */
+void breaker_free(Scene *s);
+
+/**
+ * Returns whether it is the player's turn to aim and shoot.
+ *
+ * @return true between volleys, false while balls are in flight
+ */
+bool breaker_player_enabled(void);
+
+/**
+ * Returns the current aim, in radians counterclockwise from vertical.
+ *
+ * @param s the scene returned from breaker_init()
+ * @return the aim angle
+ */
+double breaker_get_aim(Scene *s);
+
+/**
+ * Turns the trajectory to the given angle, clamped to [-MAX_AIM, MAX_AIM].
+ * Does nothing unless it is the player's turn.
+ *
+ * @param s the scene returned from breaker_init()
+ * @param angle the aim angle, in radians counterclockwise from vertical
+ */
+void breaker_set_aim(Scene *s, double angle);
+
+/**
+ * Shoots all balls along the current aim, one every shot interval.
+ * Does nothing unless it is the player's turn.
+ *
+ * @param s the scene returned from breaker_init()
+ */
+void breaker_shoot(Scene *s);
+
+/**
+ * Sets whether balls shot after the first in a volley replay its path instead
+ * of colliding with everything, which they do by default. Either way they
+ * hit the same bricks at the same places, though replayed hits only take
+ * effect at the end of their tick. Turning replay off is for checking that.
+ *
+ * @param replay true to replay the first ball's path, false to collide
+ */
+void breaker_set_replay(bool replay);
+
+/**
+ * Advances the game by dt: shoots pending balls, ticks the scene, collects
+ * balls, and starts the next round once every ball is back.
+ *
+ * @param s the scene returned from breaker_init()
+ * @param dt the time elapsed since the last tick, in seconds
+ * @return false if the game is over, true otherwise
+ */
+bool breaker_tick(Scene *s, double dt);
+
+/**
+ * Returns the current level, which is also the player's score.
+ *
+ * @return the current level
+ */
+size_t breaker_get_level(void);
+
+/**
+ * Tells whether a body rarely changes: everything but the balls and the
+ * trajectory. Can be passed to sdl_on_static().
+ *
+ * @param body a body in the scene returned from breaker_init()
+ * @return true if the body is static
+ */
+bool breaker_is_static(Body *body);
+
+/**
+ * Gets the number to show on a body, which for bricks is their health.
+ * Can be passed to sdl_on_label().
+ *
+ * @param body a body in the scene returned from breaker_init()
+ * @param number where to store the number
+ * @return true if the body has a number to show
+ */
+bool breaker_get_label(Body *body, size_t *number);
+
+/**
+ * Returns the debris of destroyed bricks, which is drawn over the scene but
+ * isn't part of it.
+ *
+ * @return the particle system holding the debris
+ */
+ParticleSystem *breaker_get_debris(void);
+
+#endif // #ifndef __BREAKER_H__
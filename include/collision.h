@@ -21,6 +21,33 @@ typedef struct {
     Vector axis;
 } CollisionInfo;
 
+/**
+ * Represents when two moving shapes overlap.
+ * Shapes moving at constant velocities overlap during at most one interval.
+ */
+typedef struct {
+    /** Whether the two shapes ever overlap */
+    bool collides;
+    /**
+     * If the shapes ever overlap, the times at which they start and stop
+     * overlapping, relative to now. The start may be negative if they
+     * already overlap, and either may be infinite.
+     */
+    double start;
+    double end;
+} CollisionInterval;
+
+/**
+ * A half-plane: the points p with vec_dot(p, normal) <= offset.
+ * Behaves like an infinitely large polygon with a single edge.
+ */
+typedef struct {
+    /** Unit vector pointing out of the half-plane, across its edge */
+    Vector normal;
+    /** Signed distance of the edge from the origin along normal */
+    double offset;
+} HalfPlane;
+
 /**
  * Computes the status of the collision between two convex polygons.
  * The shapes are given as lists of vertices in counterclockwise order.
@@ -34,4 +61,44 @@ typedef struct {
  */
 CollisionInfo find_collision(List *shape1, List *shape2);
 
+/**
+ * Computes when two convex polygons moving at constant velocities overlap,
+ * by sweeping their projections onto each separating axis.
+ * The shapes are given as in find_collision().
+ *
+ * @param shape1 the first shape
+ * @param velocity1 the velocity of the first shape
+ * @param shape2 the second shape
+ * @param velocity2 the velocity of the second shape
+ * @return whether the shapes ever overlap, and if so, when
+ */
+CollisionInterval find_collision_interval(
+    List *shape1, Vector velocity1, List *shape2, Vector velocity2
+);
+
+/**
+ * Computes the status of the collision between a half-plane and a convex
+ * polygon, from the polygon's signed distance to the half-plane's edge.
+ *
+ * @param plane the half-plane
+ * @param shape the polygon, given as in find_collision()
+ * @return whether the shapes are colliding, and if so, the collision axis,
+ * which is the half-plane's normal
+ */
+CollisionInfo find_half_plane_collision(HalfPlane plane, List *shape);
+
+/**
+ * Computes when a convex polygon moving at a constant velocity overlaps a
+ * fixed half-plane. Unlike two polygons, a polygon that is moving into the
+ * half-plane overlaps it from then on.
+ *
+ * @param plane the half-plane
+ * @param shape the polygon, given as in find_collision()
+ * @param velocity the velocity of the polygon
+ * @return whether the shapes ever overlap, and if so, when
+ */
+CollisionInterval find_half_plane_interval(
+    HalfPlane plane, List *shape, Vector velocity
+);
+
 #endif // #ifndef __COLLISION_H__
@@ -57,6 +57,9 @@ void create_drag(Scene *scene, double gamma, Body *body);
  * allowing different things to happen when bodies collide.
  * The handler is passed the bodies, the collision axis, and an auxiliary value.
  * It should only be called once while the bodies are still colliding.
+ * Collision detection may run concurrently with other collision tests
+ * (see scene_set_threads()); handlers always run one at a time, in the order
+ * the collisions were created.
  *
  * @param scene the scene containing the bodies
  * @param body1 the first body
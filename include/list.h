@@ -56,6 +56,7 @@ void *list_get(List *list, size_t index);
 
 /**
  * Sets the element at a given index in a list to the input.
+ * The old element is passed to the list's freer, if it has one.
  * Asserts that the index is valid, given the list's current size.
  *
  * @param list a pointer to a list returned from list_init()
@@ -0,0 +1,128 @@
+#ifndef __PARTICLES_H__
+#define __PARTICLES_H__
+
+#include "color.h"
+#include "list.h"
+#include "vector.h"
+
+/**
+ * A buffer of short-lived particles that move in straight lines and are never
+ * collided with, e.g. the debris of destroyed bricks. Particles share their
+ * shape and color with a prototype, so each one is only a position, a
+ * velocity and a lifetime. These are stored as separate arrays, so the whole
+ * buffer is moved and expired in one pass over contiguous memory.
+ */
+typedef struct particle_system ParticleSystem;
+
+/**
+ * Allocates memory for a particle system without any prototypes or particles.
+ * Asserts that the required memory is allocated.
+ *
+ * @param initial_size the number of particles to allocate space for
+ * @return a pointer to the newly allocated particle system
+ */
+ParticleSystem *particles_init(size_t initial_size);
+
+/**
+ * Releases the memory allocated for a particle system and its prototypes.
+ *
+ * @param particles a pointer to a particle system returned from
+ *   particles_init()
+ */
+void particles_free(ParticleSystem *particles);
+
+/**
+ * Adds a prototype that particles can be drawn from.
+ * The shape is moved so its centroid is at the origin, and each particle
+ * drawn from the prototype is drawn with its centroid at its position.
+ *
+ * @param particles a pointer to a particle system returned from
+ *   particles_init()
+ * @param shape a list of pointers to vertices describing the prototype's
+ *   shape; the particle system takes ownership of it
+ * @param color the color of particles drawn from the prototype
+ * @return the index of the prototype
+ */
+size_t particles_add_prototype(ParticleSystem *particles, List *shape,
+                                RGBColor color);
+
+/**
+ * Adds a particle drawn from a prototype.
+ * Asserts that the prototype exists.
+ *
+ * @param particles a pointer to a particle system returned from
+ *   particles_init()
+ * @param prototype the index returned from particles_add_prototype()
+ * @param position the particle's initial position
+ * @param velocity the particle's velocity
+ * @param lifetime how long the particle lives, in seconds
+ */
+void particles_add(ParticleSystem *particles, size_t prototype,
+                    Vector position, Vector velocity, double lifetime);
+
+/**
+ * Moves every particle by its velocity over a given time, and removes the
+ * particles whose lifetime has run out.
+ * This may change the order of the particles.
+ *
+ * @param particles a pointer to a particle system returned from
+ *   particles_init()
+ * @param dt the time elapsed since the last tick, in seconds
+ */
+void particles_tick(ParticleSystem *particles, double dt);
+
+/**
+ * Gets the number of live particles.
+ *
+ * @param particles a pointer to a particle system returned from
+ *   particles_init()
+ * @return the number of particles
+ */
+size_t particles_size(ParticleSystem *particles);
+
+/**
+ * Gets the position of a particle.
+ * Asserts that the index is valid.
+ *
+ * @param particles a pointer to a particle system returned from
+ *   particles_init()
+ * @param index the index of the particle
+ * @return the particle's position
+ */
+Vector particles_get_position(ParticleSystem *particles, size_t index);
+
+/**
+ * Gets the prototype a particle was drawn from.
+ * Asserts that the index is valid.
+ *
+ * @param particles a pointer to a particle system returned from
+ *   particles_init()
+ * @param index the index of the particle
+ * @return the index of the particle's prototype
+ */
+size_t particles_get_prototype(ParticleSystem *particles, size_t index);
+
+/**
+ * Gets the shape of a prototype, with its centroid at the origin.
+ * The returned list belongs to the particle system and must not be modified.
+ * Asserts that the prototype exists.
+ *
+ * @param particles a pointer to a particle system returned from
+ *   particles_init()
+ * @param prototype the index returned from particles_add_prototype()
+ * @return the list of vertices of the prototype's shape
+ */
+List *particles_get_shape(ParticleSystem *particles, size_t prototype);
+
+/**
+ * Gets the color of a prototype.
+ * Asserts that the prototype exists.
+ *
+ * @param particles a pointer to a particle system returned from
+ *   particles_init()
+ * @param prototype the index returned from particles_add_prototype()
+ * @return the color of the prototype
+ */
+RGBColor particles_get_color(ParticleSystem *particles, size_t prototype);
+
+#endif // #ifndef __PARTICLES_H__
@@ -46,4 +46,17 @@ void polygon_translate(List *polygon, Vector translation);
  */
 void polygon_rotate(List *polygon, double angle, Vector point);
 
+/**
+ * Splits a simple polygon into triangles by ear clipping.
+ * See https://en.wikipedia.org/wiki/Polygon_triangulation#Ear_clipping_method.
+ * The triangles only depend on the polygon's shape, so they stay valid when
+ * the polygon is translated or rotated.
+ *
+ * @param polygon the list of vertices that make up the polygon, in either
+ * direction, with at least 3 vertices
+ * @param indices where to store the triangles, as 3 * (n - 2) indices of
+ * vertices of the polygon, where n is the number of vertices
+ */
+void polygon_triangulate(List *polygon, size_t *indices);
+
 #endif // #ifndef __POLYGON_H__
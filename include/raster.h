@@ -0,0 +1,67 @@
+#ifndef __RASTER_H__
+#define __RASTER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Pixels drawn to by the software rasteriser, e.g. a locked streaming
+ * texture. Each pixel is a 32-bit color in whatever format the caller packs
+ * colors in. Shapes are given in pixel coordinates, and a pixel is covered
+ * when its center is inside the shape, so shapes that share an edge don't
+ * overlap. Everything outside the framebuffer is clipped.
+ */
+typedef struct framebuffer {
+    uint32_t *pixels;
+    int width;
+    int height;
+    size_t pitch;   // Pixels from the start of one row to the next
+} Framebuffer;
+
+/**
+ * Fills the whole framebuffer with a color.
+ *
+ * @param buffer the framebuffer to draw to
+ * @param color the packed color
+ */
+void raster_clear(Framebuffer *buffer, uint32_t color);
+
+/**
+ * Fills a rectangle whose sides are parallel to the axes.
+ *
+ * @param buffer the framebuffer to draw to
+ * @param x0 the left side of the rectangle
+ * @param y0 the top side of the rectangle
+ * @param x1 the right side of the rectangle
+ * @param y1 the bottom side of the rectangle
+ * @param color the packed color
+ */
+void raster_fill_rect(Framebuffer *buffer, float x0, float y0,
+                        float x1, float y1, uint32_t color);
+
+/**
+ * Fills a convex polygon.
+ * Polygons that aren't convex are filled between their leftmost and
+ * rightmost edges on each row.
+ *
+ * @param buffer the framebuffer to draw to
+ * @param xy the polygon's vertices, as packed (x, y) pairs
+ * @param n the number of vertices
+ * @param color the packed color
+ */
+void raster_fill_convex(Framebuffer *buffer, const float *xy, size_t n,
+                        uint32_t color);
+
+/**
+ * Fills a circle.
+ *
+ * @param buffer the framebuffer to draw to
+ * @param x the x coordinate of the circle's center
+ * @param y the y coordinate of the circle's center
+ * @param radius the circle's radius
+ * @param color the packed color
+ */
+void raster_fill_circle(Framebuffer *buffer, float x, float y, float radius,
+                        uint32_t color);
+
+#endif // #ifndef __RASTER_H__
@@ -20,6 +20,35 @@ typedef struct scene Scene;
  */
 typedef void (*ForceCreator)(List *bodies, void *aux);
 
+/**
+ * A function which decides whether a force creator needs to act this tick,
+ * e.g. whether two bodies have started colliding.
+ * It may be called concurrently with other testers, so it must only read the
+ * bodies and may only modify its own auxiliary value.
+ *
+ * @return whether the paired ForceCreator should be called this tick
+ */
+typedef bool (*ForceTester)(List *bodies, void *aux);
+
+/**
+ * A function which predicts when a ForceTester's result will next change,
+ * assuming every body keeps moving at its current velocity.
+ * Used by scenes in kinetic mode (see scene_set_kinetic()).
+ * Like a ForceTester, it must only read the bodies and its auxiliary value.
+ *
+ * @return the time until the tester's result changes, 0 if it would already
+ *   differ from its last result, or INFINITY if it never changes
+ */
+typedef double (*ForcePredictor)(List *bodies, void *aux);
+
+/**
+ * A function which classifies a body into one of a fixed number of types,
+ * e.g. by reading the type stored in its info.
+ * Must return a value less than the number of types given to
+ * scene_init_with_types().
+ */
+typedef size_t (*BodyTypeFunc)(Body *body);
+
 /**
  * Allocates memory for an empty scene.
  * Makes a reasonable guess of the number of bodies to allocate space for.
@@ -29,6 +58,19 @@ typedef void (*ForceCreator)(List *bodies, void *aux);
  */
 Scene *scene_init(void);
 
+/**
+ * Allocates memory for an empty scene that indexes its bodies by type.
+ * Each body added to the scene is classified with get_type and appended to
+ * a per-type list, so the bodies of one type can be iterated with
+ * scene_bodies_of_type() and scene_get_body_of_type() without scanning
+ * the whole scene.
+ *
+ * @param n_types the number of distinct body types
+ * @param get_type a function returning the type of a body
+ * @return the new scene
+ */
+Scene *scene_init_with_types(size_t n_types, BodyTypeFunc get_type);
+
 /**
  * Releases memory allocated for a given scene
  * and all the bodies and force creators it contains.
@@ -55,6 +97,49 @@ size_t scene_bodies(Scene *scene);
  */
 Body *scene_get_body(Scene *scene, size_t index);
 
+/**
+ * Gets a counter that changes whenever a body is added to or removed from a
+ * scene. As long as it is unchanged, each index holds the same body.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return a value that is unchanged as long as the scene's bodies are
+ */
+size_t scene_get_bodies_version(Scene *scene);
+
+/**
+ * Gets the number of bodies of a given type in a scene.
+ * Bodies marked for removal are counted until the next scene_tick().
+ * Asserts that the scene was created with scene_init_with_types()
+ * and that the type is valid.
+ *
+ * @param scene a pointer to a scene returned from scene_init_with_types()
+ * @param type the type of bodies to count
+ * @return the number of bodies of the given type
+ */
+size_t scene_bodies_of_type(Scene *scene, size_t type);
+
+/**
+ * Gets the body at a given index among the bodies of a given type.
+ * Bodies of a type are ordered by when they were added (or retyped).
+ * Asserts that the type and index are valid.
+ *
+ * @param scene a pointer to a scene returned from scene_init_with_types()
+ * @param type the type of the body
+ * @param index the index of the body among bodies of that type
+ * @return a pointer to the body
+ */
+Body *scene_get_body_of_type(Scene *scene, size_t type, size_t index);
+
+/**
+ * Moves a body to the type list matching its current type.
+ * Must be called whenever a body's type changes after it was added.
+ *
+ * @param scene a pointer to a scene returned from scene_init_with_types()
+ * @param body a body in the scene whose type has changed
+ * @param old_type the type the body had before the change
+ */
+void scene_retype_body(Scene *scene, Body *body, size_t old_type);
+
 /**
  * Adds a body to a scene.
  *
@@ -101,12 +186,139 @@ void scene_add_bodies_force_creator(
     Scene *scene, ForceCreator forcer, void *aux, List *bodies, FreeFunc freer
 );
 
+/**
+ * Adds a force creator that may be run in parallel with other such
+ * force creators, e.g. gravity or spring forces.
+ * Behaves like scene_add_bodies_force_creator(), but the forcer must only
+ * read bodies and call body_add_force() or body_add_impulse() on them;
+ * it must not add, remove, or otherwise modify bodies or the scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function that is safe to run concurrently
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param bodies the list of bodies affected by the force creator
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_parallel_force_creator(
+    Scene *scene, ForceCreator forcer, void *aux, List *bodies, FreeFunc freer
+);
+
+/**
+ * Adds a force creator whose work is split into a test and an action,
+ * e.g. collision detection followed by a collision handler.
+ * Every tick, runs of consecutive tested and parallel force creators are
+ * evaluated as a batch: all testers run first (possibly concurrently), then
+ * the forcers of those that returned true are called one at a time in the
+ * order the force creators were added, skipping any whose bodies were
+ * removed by an earlier forcer. Unlike parallel force creators, the forcer
+ * may modify bodies and the scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param tester a function deciding whether forcer must be called
+ * @param forcer a force creator function, called only after tester
+ * @param aux an auxiliary value to pass to tester and forcer
+ * @param bodies the list of bodies affected by the force creator
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_tested_force_creator(
+    Scene *scene,
+    ForceTester tester,
+    ForceCreator forcer,
+    void *aux,
+    List *bodies,
+    FreeFunc freer
+);
+
+/**
+ * Adds a tested force creator that can also predict when its tester will
+ * next return true, so scenes in kinetic mode only evaluate it then.
+ * Outside kinetic mode, it behaves like scene_add_tested_force_creator().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param tester a function deciding whether forcer must be called
+ * @param forcer a force creator function, called only after tester
+ * @param predictor a function predicting when tester's result changes
+ * @param aux an auxiliary value to pass to tester, forcer and predictor
+ * @param bodies the list of bodies affected by the force creator
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_predicted_force_creator(
+    Scene *scene,
+    ForceTester tester,
+    ForceCreator forcer,
+    ForcePredictor predictor,
+    void *aux,
+    List *bodies,
+    FreeFunc freer
+);
+
+/**
+ * Switches a scene into or out of kinetic (event-driven) mode.
+ * In kinetic mode, bodies move in straight lines at constant velocity, and
+ * scene_tick() advances directly from one predicted event to the next
+ * instead of sampling the scene every dt. Predicted force creators are only
+ * evaluated at their predicted events, in batches as in a normal tick.
+ * Force creators without a predictor are still evaluated once per tick,
+ * but only the impulses they add take effect: continuous forces such as
+ * gravity are not supported in this mode.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param kinetic whether to use kinetic mode
+ */
+void scene_set_kinetic(Scene *scene, bool kinetic);
+
+/**
+ * Gets the time until the next predicted event in a kinetic scene.
+ * Calling scene_tick() with this time advances exactly to the event.
+ * Asserts that the scene is in kinetic mode.
+ *
+ * @param scene a pointer to a scene in kinetic mode
+ * @return the time until the next event, or INFINITY if none is predicted
+ */
+double scene_next_event(Scene *scene);
+
+/**
+ * Sets the number of threads used to evaluate parallel and tested force
+ * creators.
+ * A batch of them is split into contiguous ranges across the threads,
+ * each of which records its forces in its own accumulator and the testers
+ * that passed in its own contact buffer. These are merged in a fixed order,
+ * so the result is identical for any number of threads.
+ * Scenes start with 1 thread, which evaluates everything serially.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param n_threads the number of threads to use, including the caller's
+ */
+void scene_set_threads(Scene *scene, size_t n_threads);
+
+/**
+ * Enables adaptive substepping: each scene_tick() is split into as many
+ * equal substeps as needed so that no body moves more than max_fraction of
+ * its radius (see body_get_radius()) per substep, up to max_substeps.
+ * Only the bodies that would move farther in one step take the substeps,
+ * and only the tested force creators acting on them are evaluated again at
+ * each one; other force creators are applied once per tick, and other bodies
+ * move once per tick. Ticks in which every body is slow take a single step.
+ * Scenes start with max_substeps 1, i.e. no substepping.
+ * Kinetic scenes never need to substep, so they ignore this setting.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param max_fraction the largest fraction of its radius a body may move
+ *   in one substep
+ * @param max_substeps the most substeps a tick may be split into
+ */
+void scene_set_substeps(Scene *scene, double max_fraction,
+                        size_t max_substeps);
+
 /**
  * Executes a tick of a given scene over a small time interval.
  * This requires executing all the force creators
  * and then ticking each body (see body_tick()).
  * If any bodies are marked for removal, they should be removed from the scene
  * and freed, along with any force creators acting on them.
+ * The tick may be split into substeps (see scene_set_substeps()).
+ * In kinetic mode, the scene instead advances through the predicted events
+ * within dt (see scene_set_kinetic()).
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param dt the time elapsed since the last tick, in seconds
@@ -7,7 +7,9 @@
 #include <SDL2/SDL_ttf.h>
 #include "color.h"
 #include "list.h"
+#include "particles.h"
 #include "scene.h"
+#include "snapshot.h"
 #include "vector.h"
 
 // Values passed to a key handler when the given arrow key is pressed
@@ -52,6 +54,14 @@ typedef void (*KeyHandler)(
  */
 void sdl_init(Vector min, Vector max);
 
+/**
+ * Closes the font, releases the cached text, sprites and other textures and
+ * buffers kept for drawing, and closes the window.
+ * Should be called once nothing else will be drawn; no other function in
+ * this file may be called afterwards.
+ */
+void sdl_quit(void);
+
 /**
  * Processes all SDL events and returns whether the window has been closed.
  * This function must be called in order to handle keypresses.
@@ -61,6 +71,31 @@ void sdl_init(Vector min, Vector max);
  */
 bool sdl_is_done(void);
 
+/**
+ * Waits until an SDL event arrives or a timeout passes, then processes all
+ * SDL events like sdl_is_done(). Lets a loop that only draws when something
+ * changed sleep while nothing does.
+ *
+ * @param timeout the longest time to wait, in seconds
+ * @return true if the window was closed, false otherwise
+ */
+bool sdl_wait(double timeout);
+
+/**
+ * Wakes a call to sdl_wait(), e.g. when another thread has something new to
+ * draw. Can be called from any thread.
+ */
+void sdl_wake(void);
+
+/**
+ * Tells whether a key was pressed or released, or the window was shown,
+ * exposed or resized, since the last frame was shown. The window's contents
+ * may then be stale even if the scene hasn't changed.
+ *
+ * @return true if the next frame should be drawn anyway
+ */
+bool sdl_needs_redraw(void);
+
 /**
  * Clears the screen. Should be called before drawing polygons in each frame.
  */
@@ -81,13 +116,26 @@ void sdl_draw_polygon(List *points, RGBColor color);
 void sdl_show(void);
 
 /**
- * Draws all bodies in a scene.
+ * Draws all bodies in a scene, then the particles over them.
+ * The scene is captured with the handlers registered by sdl_on_static() and
+ * sdl_on_label(), then drawn by sdl_render_snapshot().
+ *
+ * @param scene the scene to draw
+ * @param particles the particles to draw, or NULL for none
+ */
+void sdl_render_scene(Scene *scene, ParticleSystem *particles,
+                        List *texture, List *rect);
+
+/**
+ * Draws a captured scene and its particles, e.g. one published by a thread
+ * running the simulation. Its static bodies go in the static layer if a
+ * static handler has been registered with sdl_on_static().
  * This internally calls sdl_clear(), sdl_draw_polygon(), and sdl_show(),
  * so those functions should not be called directly.
  *
- * @param scene the scene to draw
+ * @param snapshot the snapshot to draw
  */
-void sdl_render_scene(Scene *scene, List *texture, List *rect);
+void sdl_render_snapshot(Snapshot *snapshot, List *texture, List *rect);
 
 /**
  * Registers a function to be called every time a key is pressed.
@@ -117,6 +165,61 @@ void sdl_render_scene(Scene *scene, List *texture, List *rect);
  */
 void sdl_on_key(KeyHandler handler, void *aux);
 
+/**
+ * Registers a function that labels the bodies of rendered scenes with
+ * numbers. The digits are drawn from a texture rendered once, so labels
+ * cost no font work while drawing.
+ * Overwrites any existing handler.
+ *
+ * @param handler the function giving each body's label, or NULL for none
+ */
+void sdl_on_label(LabelHandler handler);
+
+/**
+ * Chooses whether presenting a frame waits for the display's vertical sync,
+ * which limits frames to the display's refresh rate without tearing.
+ * Off by default.
+ *
+ * @param enabled whether to wait for vertical sync
+ */
+void sdl_set_vsync(bool enabled);
+
+/**
+ * Limits how many frames per second sdl_show() presents, by sleeping until
+ * the next frame is due. Frames are due at fixed intervals, so the rate
+ * stays accurate even though sleeps aren't. While the window doesn't have
+ * input focus, frames are limited to 30 per second, and while it is hidden
+ * or minimized, to 4 per second and nothing is drawn.
+ *
+ * @param fps the most frames per second, or 0 for no limit (the default)
+ */
+void sdl_set_frame_rate(double fps);
+
+/**
+ * Chooses how rendered scenes are drawn: by SDL's renderer, or by a software
+ * rasteriser that fills spans of pixels straight into a streaming texture,
+ * which is faster where the renderer falls back to software anyway.
+ * The static layer isn't used by the rasteriser, and labels and text are
+ * drawn by the renderer either way.
+ *
+ * @param enabled whether to use the software rasteriser
+ */
+void sdl_use_software_raster(bool enabled);
+
+/**
+ * Registers a function that picks the bodies of rendered scenes that rarely
+ * change. They are drawn below the other bodies, into a texture that is
+ * kept between frames. Only the regions where one of them appeared,
+ * disappeared, moved, or changed color or label are redrawn, so each frame
+ * costs about as much as drawing the other bodies. Rotating a static body
+ * without moving its centroid isn't noticed.
+ * Overwrites any existing handler.
+ *
+ * @param handler the function picking static bodies, or NULL to draw every
+ *   body every frame
+ */
+void sdl_on_static(StaticHandler handler);
+
 /**
  * Gets the amount of time that has passed since the last time
  * this function was called, in seconds.
@@ -127,6 +230,9 @@ double time_since_last_tick(void);
 
 /**
  * Renders text
+ * Rendered strings are cached, so asking for the same text again is cheap.
+ * The texture belongs to the cache and must not be destroyed; it stays valid
+ * until many other strings have been rendered since it was last asked for.
  *
  * @param texture pointer to SDL_Texture * to be rendered
  * @param rect pointer to SDL_Rect to be render
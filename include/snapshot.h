@@ -0,0 +1,256 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdbool.h>
+#include "color.h"
+#include "list.h"
+#include "particles.h"
+#include "scene.h"
+#include "vector.h"
+
+/**
+ * A label handler.
+ * When a scene is captured, each body is passed to the handler, which can
+ * give a number to draw on top of it.
+ *
+ * @param body a body being captured
+ * @param number where to store the number to draw
+ * @return true if the body should be labelled with the stored number
+ */
+typedef bool (*LabelHandler)(Body *body, size_t *number);
+
+/**
+ * A static handler.
+ * When a scene is captured, each body is passed to the handler, which tells
+ * whether the body rarely changes, like the background or a wall.
+ *
+ * @param body a body being captured
+ * @return true if the body belongs in the static layer
+ */
+typedef bool (*StaticHandler)(Body *body);
+
+/**
+ * Everything needed to draw a scene and its particles at one instant:
+ * the shape, color, centroid and label of each body, and the position and
+ * prototype of each particle. A snapshot owns copies of all of these, so it
+ * can be drawn on one thread while the scene keeps changing on another.
+ * Its memory is reused when it is captured again.
+ */
+typedef struct snapshot Snapshot;
+
+/**
+ * Three snapshots shared by one thread that captures scenes and one that
+ * draws them, without locks. The capturing thread always has a snapshot to
+ * write, and the drawing thread always has the newest complete one to read,
+ * so neither waits for the other; snapshots captured faster than they are
+ * drawn are skipped.
+ */
+typedef struct snapshot_buffer SnapshotBuffer;
+
+/**
+ * Allocates memory for an empty snapshot.
+ * Asserts that the required memory is allocated.
+ *
+ * @return a pointer to the newly allocated snapshot
+ */
+Snapshot *snapshot_init(void);
+
+/**
+ * Releases the memory allocated for a snapshot.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ */
+void snapshot_free(Snapshot *snapshot);
+
+/**
+ * Copies the current state of a scene and its particles into a snapshot,
+ * replacing what it held. A body's shape is only copied again when bodies
+ * were added to or removed from the scene, or the body's motion changed (see
+ * body_get_motion_version()); otherwise it has only moved along its velocity,
+ * and the copy is moved to its centroid when it is drawn. Prototypes of
+ * particles are assumed not to change once added, so they are only copied the
+ * first time they are seen.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @param scene the scene to capture
+ * @param particles the particles to capture, or NULL for none
+ * @param is_static the function picking the static bodies, or NULL for none
+ * @param get_label the function giving each body's label, or NULL for none
+ */
+void snapshot_capture(Snapshot *snapshot, Scene *scene,
+                        ParticleSystem *particles, StaticHandler is_static,
+                        LabelHandler get_label);
+
+/**
+ * Gets the number of bodies captured in a snapshot.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @return the number of bodies, in the order they were in the scene
+ */
+size_t snapshot_bodies(Snapshot *snapshot);
+
+/**
+ * Gets a value identifying a captured body, which is the same in every
+ * snapshot of the body. It is only meant to be compared, since the body
+ * itself may have been freed.
+ * Asserts that the index is valid.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @param index the index of the body
+ * @return the body's identity
+ */
+const void *snapshot_get_id(Snapshot *snapshot, size_t index);
+
+/**
+ * Gets the shape of a captured body, moving its copy to the body's centroid
+ * the first time it is asked for. So it must only be called by the thread
+ * drawing the snapshot.
+ * The returned list belongs to the snapshot and must not be modified.
+ * Asserts that the index is valid.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @param index the index of the body
+ * @return the list of vertices of the body's shape
+ */
+List *snapshot_get_shape(Snapshot *snapshot, size_t index);
+
+/**
+ * Gets the centroid of a captured body.
+ * Asserts that the index is valid.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @param index the index of the body
+ * @return the body's centroid
+ */
+Vector snapshot_get_centroid(Snapshot *snapshot, size_t index);
+
+/**
+ * Gets the color of a captured body.
+ * Asserts that the index is valid.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @param index the index of the body
+ * @return the body's color
+ */
+RGBColor snapshot_get_color(Snapshot *snapshot, size_t index);
+
+/**
+ * Gets whether a captured body was picked as static.
+ * Asserts that the index is valid.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @param index the index of the body
+ * @return whether the body belongs in the static layer
+ */
+bool snapshot_is_static(Snapshot *snapshot, size_t index);
+
+/**
+ * Gets the label of a captured body.
+ * Asserts that the index is valid.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @param index the index of the body
+ * @param number where to store the number to draw
+ * @return true if the body is labelled with the stored number
+ */
+bool snapshot_get_label(Snapshot *snapshot, size_t index, size_t *number);
+
+/**
+ * Gets the number of particles captured in a snapshot.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @return the number of particles
+ */
+size_t snapshot_particles(Snapshot *snapshot);
+
+/**
+ * Gets the position of a captured particle.
+ * Asserts that the index is valid.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @param index the index of the particle
+ * @return the particle's position
+ */
+Vector snapshot_get_particle_position(Snapshot *snapshot, size_t index);
+
+/**
+ * Gets the shape of a captured particle's prototype, with its centroid at
+ * the origin.
+ * The returned list belongs to the snapshot and must not be modified.
+ * Asserts that the index is valid.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @param index the index of the particle
+ * @return the list of vertices of the particle's shape
+ */
+List *snapshot_get_particle_shape(Snapshot *snapshot, size_t index);
+
+/**
+ * Gets the color of a captured particle.
+ * Asserts that the index is valid.
+ *
+ * @param snapshot a pointer to a snapshot returned from snapshot_init()
+ * @param index the index of the particle
+ * @return the particle's color
+ */
+RGBColor snapshot_get_particle_color(Snapshot *snapshot, size_t index);
+
+/**
+ * Allocates memory for a buffer of three empty snapshots.
+ * Asserts that the required memory is allocated.
+ *
+ * @return a pointer to the newly allocated buffer
+ */
+SnapshotBuffer *snapshot_buffer_init(void);
+
+/**
+ * Releases the memory allocated for a buffer and its snapshots.
+ * Neither thread may be using the buffer.
+ *
+ * @param buffer a pointer to a buffer returned from snapshot_buffer_init()
+ */
+void snapshot_buffer_free(SnapshotBuffer *buffer);
+
+/**
+ * Gets the snapshot the capturing thread should write next.
+ * Only the capturing thread may call this.
+ *
+ * @param buffer a pointer to a buffer returned from snapshot_buffer_init()
+ * @return a snapshot that the drawing thread isn't using
+ */
+Snapshot *snapshot_buffer_back(SnapshotBuffer *buffer);
+
+/**
+ * Hands the snapshot returned from snapshot_buffer_back() to the drawing
+ * thread, replacing any snapshot it hasn't picked up yet. A snapshot that
+ * looks the same as the last one published isn't handed over, and its slot
+ * is written again by the next capture.
+ * Only the capturing thread may call this.
+ *
+ * @param buffer a pointer to a buffer returned from snapshot_buffer_init()
+ * @return whether the snapshot was published
+ */
+bool snapshot_buffer_publish(SnapshotBuffer *buffer);
+
+/**
+ * Counts the snapshots published so far, so it only advances when the
+ * captured scene changed. A snapshot at least as new as the count is ready
+ * for snapshot_buffer_front() by the time the count is seen.
+ * Any thread may call this.
+ *
+ * @param buffer a pointer to a buffer returned from snapshot_buffer_init()
+ * @return the number of snapshots published
+ */
+size_t snapshot_buffer_changes(SnapshotBuffer *buffer);
+
+/**
+ * Gets the newest published snapshot. It stays valid, and isn't written,
+ * until this is called again.
+ * Only the drawing thread may call this.
+ *
+ * @param buffer a pointer to a buffer returned from snapshot_buffer_init()
+ * @return the newest snapshot, or NULL if none has been published yet
+ */
+Snapshot *snapshot_buffer_front(SnapshotBuffer *buffer);
+
+#endif // #ifndef __SNAPSHOT_H__
@@ -0,0 +1,72 @@
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include "list.h"
+
+/**
+ * A hierarchical timer wheel, which calls back functions at given times.
+ * Time is divided into slots of a fixed resolution. Timers due within the
+ * next few slots are kept in the slot they are due in; later timers are kept
+ * in coarser wheels, and moved down to finer ones as their time approaches.
+ * So scheduling a timer and advancing past a slot both take constant time,
+ * however many timers are pending.
+ */
+typedef struct timer_wheel TimerWheel;
+
+/**
+ * A function called when a timer is due.
+ * The auxiliary value is the one the timer was scheduled with.
+ */
+typedef void (*TimerCallback)(void *aux);
+
+/**
+ * Allocates memory for a timer wheel without any timers, at time 0.
+ * Asserts that the resolution is positive and that the required memory is
+ * allocated.
+ *
+ * @param resolution the length of each slot of the wheel, in seconds
+ * @return a pointer to the newly allocated timer wheel
+ */
+TimerWheel *timer_wheel_init(double resolution);
+
+/**
+ * Releases the memory allocated for a timer wheel and its pending timers.
+ * The timers' callbacks are not called.
+ *
+ * @param wheel a pointer to a timer wheel returned from timer_wheel_init()
+ */
+void timer_wheel_free(TimerWheel *wheel);
+
+/**
+ * Schedules a callback to be called once the wheel is advanced to the given
+ * time. A time that has already passed is due the next time the wheel is
+ * advanced.
+ *
+ * @param wheel a pointer to a timer wheel returned from timer_wheel_init()
+ * @param time the time at which the callback is due, in seconds
+ * @param callback the function to call
+ * @param aux the auxiliary value to pass to the callback
+ */
+void timer_wheel_schedule(TimerWheel *wheel, double time,
+                            TimerCallback callback, void *aux);
+
+/**
+ * Advances a timer wheel to the given time, calling back every timer that is
+ * due by then. Timers in earlier slots are called first. Callbacks may
+ * schedule more timers; those that are already due are called the next time
+ * the wheel is advanced.
+ *
+ * @param wheel a pointer to a timer wheel returned from timer_wheel_init()
+ * @param time the new time, in seconds, which must not go backwards
+ */
+void timer_wheel_advance(TimerWheel *wheel, double time);
+
+/**
+ * Gets the time a timer wheel was last advanced to.
+ *
+ * @param wheel a pointer to a timer wheel returned from timer_wheel_init()
+ * @return the wheel's time, in seconds
+ */
+double timer_wheel_time(TimerWheel *wheel);
+
+#endif // #ifndef __TIMER_H__
@@ -0,0 +1,75 @@
+#ifndef __TWEEN_H__
+#define __TWEEN_H__
+
+#include "body.h"
+#include "vector.h"
+
+/**
+ * A set of tweens, each of which moves a body in a straight line to a target
+ * over a fixed time and then calls back. Tweens are scripted motion: the body
+ * is placed along its line each tick instead of being moved by its velocity,
+ * so it can be left out of collision detection and doesn't need to be polled.
+ * Tweens are kept in one compact array and advanced in a single pass.
+ */
+typedef struct tween_system TweenSystem;
+
+/**
+ * A function called when a tween finishes, with its body at the target.
+ * The auxiliary value is the one the tween was added with.
+ */
+typedef void (*TweenCallback)(Body *body, void *aux);
+
+/**
+ * Allocates memory for a tween system without any tweens.
+ * Asserts that the required memory is allocated.
+ *
+ * @param initial_size the number of tweens to allocate space for
+ * @return a pointer to the newly allocated tween system
+ */
+TweenSystem *tweens_init(size_t initial_size);
+
+/**
+ * Releases the memory allocated for a tween system.
+ * Unfinished tweens are dropped without calling back.
+ *
+ * @param tweens a pointer to a tween system returned from tweens_init()
+ */
+void tweens_free(TweenSystem *tweens);
+
+/**
+ * Starts moving a body from where it is now to a target.
+ * The body must not be freed before the tween finishes, but may be removed
+ * from its scene; tweens of removed bodies are dropped without calling back.
+ * Asserts that the duration isn't negative.
+ *
+ * @param tweens a pointer to a tween system returned from tweens_init()
+ * @param body the body to move
+ * @param target where the body's centroid should end up
+ * @param duration how long the body takes to reach the target, in seconds
+ * @param callback the function to call once the body reaches the target,
+ *   or NULL
+ * @param aux the auxiliary value to pass to the callback
+ */
+void tweens_add(TweenSystem *tweens, Body *body, Vector target,
+                double duration, TweenCallback callback, void *aux);
+
+/**
+ * Advances every tween by a given time, moving its body along its line.
+ * Tweens that finish are removed, then their callbacks are called in the
+ * order the tweens were added. Tweens added by callbacks start on the next
+ * tick; callbacks must not tick the system themselves.
+ *
+ * @param tweens a pointer to a tween system returned from tweens_init()
+ * @param dt the time elapsed since the last tick, in seconds
+ */
+void tweens_tick(TweenSystem *tweens, double dt);
+
+/**
+ * Gets the number of unfinished tweens.
+ *
+ * @param tweens a pointer to a tween system returned from tweens_init()
+ * @return the number of tweens
+ */
+size_t tweens_size(TweenSystem *tweens);
+
+#endif // #ifndef __TWEEN_H__
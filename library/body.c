@@ -1,10 +1,12 @@
 #include <stdlib.h>
 #include <assert.h>
+#include <math.h>
 #include "body.h"
 
 typedef struct body {
     List *shape;
     Vector centroid;
+    double radius;      // Distance from centroid to farthest vertex
     double mass;
     RGBColor color;
     double orientation;
@@ -14,8 +16,79 @@ typedef struct body {
     void *info;
     FreeFunc info_freer;
     bool removed;
+    bool collidable;
+    bool is_half_plane;
+    HalfPlane plane;        // Collider used instead of shape, if is_half_plane
+    size_t motion_version;  // Changed when motion is changed from outside
 } Body;
 
+#define ACCUMULATOR_SIZE 64   // # contributions to initialize accumulator with
+
+/* A force or impulse recorded by an accumulator. */
+typedef struct contribution {
+    Body *body;
+    Vector value;
+    bool is_impulse;
+} Contribution;
+
+typedef struct body_accumulator {
+    size_t max_size;
+    size_t length;
+    Contribution *arr;
+} BodyAccumulator;
+
+/* Accumulator that the calling thread's forces and impulses are recorded into,
+ * or NULL if they are applied directly.
+ */
+_Thread_local BodyAccumulator *curr_accumulator = NULL;
+
+/* Records a force or impulse in the accumulator, growing it if needed. */
+void accumulator_add(BodyAccumulator *acc, Body *body, Vector value,
+                        bool is_impulse) {
+    if (acc->length == acc->max_size) {
+        acc->max_size *= 2;
+        acc->arr = realloc(acc->arr, acc->max_size * sizeof(Contribution));
+        assert(acc->arr != NULL);
+    }
+    acc->arr[acc->length++] = (Contribution) {body, value, is_impulse};
+}
+
+BodyAccumulator *body_accumulator_init(void) {
+    BodyAccumulator *acc = malloc(sizeof(BodyAccumulator));
+    assert(acc != NULL);
+    acc->max_size = ACCUMULATOR_SIZE;
+    acc->length = 0;
+    acc->arr = malloc(ACCUMULATOR_SIZE * sizeof(Contribution));
+    assert(acc->arr != NULL);
+    return acc;
+}
+
+void body_accumulator_free(BodyAccumulator *acc) {
+    free(acc->arr);
+    free(acc);
+}
+
+void body_accumulator_begin(BodyAccumulator *acc) {
+    curr_accumulator = acc;
+}
+
+void body_accumulator_end(void) {
+    curr_accumulator = NULL;
+}
+
+void body_accumulator_apply(BodyAccumulator *acc) {
+    for (size_t i = 0; i < acc->length; i++) {
+        Contribution c = acc->arr[i];
+        if (c.is_impulse) {
+            c.body->impulse = vec_add(c.body->impulse, c.value);
+        }
+        else {
+            c.body->force = vec_add(c.body->force, c.value);
+        }
+    }
+    acc->length = 0;
+}
+
 Body *body_init(List *shape, double mass, RGBColor color) {
     return body_init_with_info(shape, mass, color, NULL, NULL);
 }
@@ -29,6 +102,14 @@ Body *body_init_with_info(List *shape, double mass, RGBColor color, void *info,
 
     b->shape = shape;
     b->centroid = polygon_centroid(shape);
+    b->radius = 0.0;
+    for (size_t i = 0; i < list_size(shape); i++) {
+        double r = vec_norm(vec_subtract(v_cast(list_get(shape, i)),
+                                            b->centroid));
+        if (r > b->radius) {
+            b->radius = r;
+        }
+    }
     b->mass = mass;
     b->color = color;
     b->orientation = 0.0;
@@ -38,6 +119,10 @@ Body *body_init_with_info(List *shape, double mass, RGBColor color, void *info,
     b->info = info;
     b->info_freer = info_freer;
     b->removed = false;
+    b->collidable = true;
+    b->is_half_plane = false;
+    b->plane = (HalfPlane) {VEC_ZERO, 0.0};
+    b->motion_version = 0;
 
     return b;
 }
@@ -57,10 +142,18 @@ List *body_get_shape(Body *body) {
     return pts;
 }
 
+List *body_borrow_shape(Body *body) {
+    return body->shape;
+}
+
 Vector body_get_centroid(Body *body) {
     return body->centroid;
 }
 
+double body_get_radius(Body *body) {
+    return body->radius;
+}
+
 Vector body_get_velocity(Body *body) {
     return body->velocity;
 }
@@ -85,27 +178,58 @@ void body_set_color(Body *body, RGBColor color) {
     body->color = color;
 }
 
-void body_set_centroid(Body *body, Vector x) {
+size_t body_get_motion_version(Body *body) {
+    return body->motion_version;
+}
+
+/* Translates a body without marking its motion as changed. */
+void body_translate(Body *body, Vector x) {
     Vector delta = vec_subtract(x, body->centroid);
     polygon_translate(body->shape, delta);
     body->centroid = x;
+    body->plane.offset += vec_dot(delta, body->plane.normal);
+}
+
+void body_set_centroid(Body *body, Vector x) {
+    body_translate(body, x);
+    body->motion_version++;
 }
 
 void body_set_velocity(Body *body, Vector v) {
     body->velocity = v;
+    body->motion_version++;
 }
 
 void body_set_rotation(Body *body, double angle, Vector point) {
     double delta = angle - body->orientation;
     body->orientation = angle;
     polygon_rotate(body->shape, delta, point);
+    if (body->is_half_plane) {
+        Vector edge = vec_multiply(body->plane.offset, body->plane.normal);
+        edge = vec_add(vec_rotate(vec_subtract(edge, point), delta), point);
+        body->plane.normal = vec_rotate(body->plane.normal, delta);
+        body->plane.offset = vec_dot(edge, body->plane.normal);
+    }
+    body->motion_version++;
+}
+
+Vector body_get_force(Body *body) {
+    return body->force;
 }
 
 void body_add_force(Body *body, Vector force) {
+    if (curr_accumulator) {
+        accumulator_add(curr_accumulator, body, force, false);
+        return;
+    }
     body->force = vec_add(body->force, force);
 }
 
 void body_add_impulse(Body *body, Vector impulse) {
+    if (curr_accumulator) {
+        accumulator_add(curr_accumulator, body, impulse, true);
+        return;
+    }
     body->impulse = vec_add(body->impulse, impulse);
 }
 
@@ -115,6 +239,10 @@ void body_reset_impulse(Body *body) {
 
 void body_tick(Body *body, double dt) {
     Vector v_old = body->velocity; // Store old value to use when translating
+    if (!vec_equal(body->force, VEC_ZERO) || !vec_equal(body->impulse, VEC_ZERO))
+    {
+        body->motion_version++;
+    }
 
     // Apply force
     Vector accel = vec_divide(body->mass, body->force);
@@ -127,7 +255,9 @@ void body_tick(Body *body, double dt) {
     // Translate body at avg of velocities before and after tick
     Vector v_avg = vec_divide(2, vec_add(v_old, body->velocity));
     Vector displacement = vec_multiply(dt, v_avg);
-    body_set_centroid(body, vec_add(body->centroid, displacement));
+    if (!vec_equal(displacement, VEC_ZERO)) {
+        body_translate(body, vec_add(body->centroid, displacement));
+    }
 
     // Reset force / impulse
     body->force = body->impulse = VEC_ZERO;
@@ -144,3 +274,33 @@ bool body_is_removed(Body *body) {
 bool body_is_stationary(Body *body) {
     return (body->velocity.x == 0 && body->velocity.y == 0);
 }
+
+void body_set_collidable(Body *body, bool collidable) {
+    body->collidable = collidable;
+    body->motion_version++;
+}
+
+bool body_is_collidable(Body *body) {
+    return body->collidable;
+}
+
+void body_set_half_plane(Body *body, Vector normal) {
+    // The edge is the shape's farthest extent along normal
+    double offset = -INFINITY;
+    for (size_t i = 0; i < list_size(body->shape); i++) {
+        double d = vec_dot(v_cast(list_get(body->shape, i)), normal);
+        if (d > offset) {
+            offset = d;
+        }
+    }
+    body->is_half_plane = true;
+    body->plane = (HalfPlane) {normal, offset};
+    body->motion_version++;
+}
+
+bool body_get_half_plane(Body *body, HalfPlane *plane) {
+    if (body->is_half_plane) {
+        *plane = body->plane;
+    }
+    return body->is_half_plane;
+}
@@ -0,0 +1,1597 @@
+#include "breaker.h"
+#include "forces.h"
+#include "timer.h"
+#include "tween.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define WHITE ((RGBColor) {1, 1, 1})
+#define BALL_COLOR ((RGBColor) {138.0 / 255, 223.0 / 255, 220.0 / 255})
+
+// Full health brick color
+#define BRICK_COLOR ((RGBColor) {115.0 / 255, 83.0 / 255, 114.0 / 255})
+
+// Collectible ball color
+#define C_BALL_COLOR ((RGBColor) {252.0 / 255, 81.0 / 255, 133.0 / 255})
+
+#define LIFE_COLOR ((RGBColor) {92.0 / 255, 214.0 / 255, 92.0 / 255})
+#define BOMB_COLOR ((RGBColor) {1.0, 0.3, 0.3})
+#define WALL_COLOR ((RGBColor) {0, 0, 0})
+#define TRAJ_COLOR ((RGBColor) {0.6, 0.9, 0.9})
+#define TRAJ_WIDTH 0.5
+#define TRAJ_HEIGHT HEIGHT * 2
+
+#define N_ROWS 3    // # rows of bricks
+#define N_COLS 6    // # cols of bricks
+#define GRID_ROWS 10    // # rows on screen, HEIGHT / BRICK_TOTAL_HEIGHT
+#define BRICK_SPACING 1
+#define BRICK_TOTAL_WIDTH (WIDTH / N_COLS)  // Includes margin
+#define BRICK_TOTAL_HEIGHT 10
+#define BRICK_WIDTH ((WIDTH - ((N_COLS + 1) * BRICK_SPACING)) / N_COLS)
+#define BRICK_HEIGHT (BRICK_TOTAL_HEIGHT - BRICK_SPACING)
+#define ARROW_HEIGHT 100
+#define ARROW_WIDTH 20
+#define LIFE_SIZE 6.0               // Width and height of collectibles
+#define BOMB_SIZE 4.0
+
+#define POINTS_IN_CIRCLE 20         // For drawing circles as polygons
+#define RADIUS 2.0                  // Radius of ball
+
+#define MASS 5.0                    // Mass of the ball
+#define VELOCITY (Vector) {0, 100}  // Velocity of ball (perpendicular to floor)
+#define VELOCITY_RIGHT (Vector) {100, 0}   // Velocity of ball being collected
+#define PLAYER_SPEED 100.0
+#define ELASTICITY 1.0
+
+#define INTERVAL 0.05               // Time interval at which balls are shot
+#define TIMER_RESOLUTION 0.005      // Seconds per slot of the timer wheel
+#define LIFE_MOVE_TIME 0.25         // Time a collected life takes to move aside
+
+#define LIFE_PROB 0.08              // Probability of generating a life powerup
+#define BOMB_PROB 0.04              // Probability of generating a bomb powerup
+
+// game_state.ball_loc when no balls have been collected
+#define NULL_BALL_LOC (Vector) {0, 0}
+
+#define MAX_CONTACTS 4              // Most bodies a ball can hit at once
+#define SEGMENTS 64                 // Initial capacity of the volley's path
+#define OFF_PATH SIZE_MAX           // Segment of a ball cut off the path
+
+
+typedef enum {
+    READY,
+    BOUNCING,
+    RETURNING,  // Rolling along the floor towards ball_loc
+    WAITING,
+    N_BALL_STATUSES
+} BallStatus;
+
+/* A straight piece of a ball's path, starting with the bodies the ball hit
+ * to begin it.
+ */
+typedef struct segment {
+    double time;        // Time since the shot at which the segment starts
+    Vector pos;
+    Vector velocity;
+    Body *contacts[MAX_CONTACTS];
+    size_t n_contacts;
+} Segment;
+
+typedef struct ball_info {
+    BallStatus status;
+    bool replaying;     // Following the volley's path instead of colliding
+    size_t segment;     // Index of the path segment being replayed, or OFF_PATH
+    double time;        // Time since the ball was shot, while replaying
+    Segment off;        // Last segment of a ball that left the path
+    Segment release;    // Next contact after off, where it collides again
+    Body *leader;       // Ball whose next contact is release, until it's known
+    bool leading;       // Whether balls off the path wait for its next contact
+} BallInfo;
+
+/* The path of the balls in the current volley. Every ball is shot from the
+ * same place in the same direction, so later balls replay the path recorded
+ * by the first one instead of colliding with every brick.
+ * When a brick on the path is destroyed, the path is cut at the first contact
+ * with it. The next ball to reach the cut continues it with real collisions.
+ * Balls only ever stop replaying at a contact, with the velocity they had
+ * before it, and never get ahead of the ball recording the path. Up to there,
+ * the path only passes through space the recording ball found empty, and
+ * bodies never appear during a volley, so the real collisions at the contact
+ * happen as they did for the recording ball, and a ball is never released
+ * inside a body.
+ */
+typedef struct path {
+    Segment *segments;
+    size_t n_segments;
+    size_t n_stale;     // Segments past a cut this tick, see replay_path()
+    size_t max_segments;
+    Body *recorder;     // Ball whose bounces extend the path, if any
+    double end_time;    // When the path was cut, or INFINITY if it wasn't
+    Body *stale_leader; // Recorder when the stale segments were cut off
+    double stale_end;   // end_time then, if there was no recorder
+} Path;
+
+/* The bricks and collectibles on the board, one per cell. Rows are kept in a
+ * ring buffer, so moving the board down a row doesn't move any cells. Shapes
+ * are kept in world space, as collisions, snapshots and drawing read them, so
+ * each body on the board is still translated down a row when it moves.
+ */
+typedef struct grid {
+    Body *cells[GRID_ROWS * N_COLS];    // Row-major, NULL for empty cells
+    size_t top;                         // Ring index of the top row
+} Grid;
+
+/* A row of bricks before it is added to the scene. */
+typedef struct row_record {
+    size_t health[N_COLS];      // Health of the brick in each column, or 0
+    BodyType collectible;       // C_BALL, C_LIFE, C_BOMB, or MISC for none
+    size_t collectible_col;
+} RowRecord;
+
+typedef struct game_state {
+    bool player_enabled;
+    int lives;
+    List *shoot_balls;
+    Vector ball_loc;    // Where balls are collected after bouncing
+    size_t n_balls;                         // # balls in the scene
+    size_t ball_counts[N_BALL_STATUSES];    // # balls with each status
+    size_t level;                           // Also the score
+    double time;                            // Game time, in seconds
+    TimerWheel *timers;         // Shots
+    double next_shot;           // When the pending shot is due
+    TweenSystem *tweens;        // Balls being collected, lives moving aside
+    List *rolling;              // Balls that started returning this tick
+    ParticleSystem *debris;     // Pieces of destroyed bricks
+    size_t debris_left;         // Prototypes of the pieces
+    size_t debris_right;
+    Path path;
+    bool replay;            // Whether later balls replay the first one's path
+    Grid grid;
+    bool endless;           // Rows come from an endless board, see board_row()
+    uint64_t board_seed;
+    uint64_t *row_stream;   // Replaces rand() while drawing a board row
+} GameState;
+
+
+// Global game state
+GameState game_state;
+
+// Function forward declarations
+Body *generate_ball();
+void add_ball_forces(Scene *s, Body *ball);
+void collect_ball(Body *ball);
+void use_life(Scene *s);
+void create_collect_collision(Scene *s, Body *c_ball, Body *ball);
+RowRecord board_row(size_t index);
+void add_row(Scene *s, RowRecord *row);
+
+
+/* Frees the BodyInfo struct */
+void free_body_info(BodyInfo *info) {
+    if (info->aux_free) {
+        info->aux_free(info->aux);
+    }
+    free(info);
+}
+
+/* Returns the next number between 0 and 1 from a splitmix64 stream. */
+double stream_num(uint64_t *stream) {
+    uint64_t z = (*stream += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (z >> 11) * 0x1.0p-53;
+}
+
+/* Generates a random number between 0 and 1 */
+double rand_num() {
+    if (game_state.row_stream) {
+        return stream_num(game_state.row_stream);
+    }
+    return (double)rand() / RAND_MAX;
+}
+
+/* Generates a random integer between begin (inclusive) and end (exclusive). */
+int rand_int(int begin, int end) {
+    int num = begin + floor(rand_num() * (end - begin));
+    assert(num >= begin && num < end);
+    return num;
+}
+
+/* Randomly choose which columns to put new bricks in the new row and returns
+ * an array of boolean values with size N_COLS indicating which columns will
+ * have bricks.
+ */
+void choose_cols(bool *cols) {
+    int count = 0;
+    for (size_t i = 0; i < N_COLS; i++) {
+        if (rand_num() < 0.3) {
+            cols[i] = 1;
+            count += 1;
+        }
+        else {
+            cols[i] = 0;
+        }
+    }
+    if (count == 0) {
+        cols[0] = 1;
+    }
+}
+
+List *rect_init(double width, double height) {
+    Vector half_width  = {.x = width / 2, .y = 0.0},
+           half_height = {.x = 0.0, .y = height / 2};
+    List *rect = list_init(4, free);
+    Vector *v = malloc(sizeof(*v));
+    *v = vec_add(half_width, half_height);
+    list_add(rect, v);
+    v = malloc(sizeof(*v));
+    *v = vec_subtract(half_height, half_width);
+    list_add(rect, v);
+    v = malloc(sizeof(*v));
+    *v = vec_negate(*(Vector *) list_get(rect, 0));
+    list_add(rect, v);
+    v = malloc(sizeof(*v));
+    *v = vec_subtract(half_width, half_height);
+    list_add(rect, v);
+    return rect;
+}
+
+/** Constructs a circle with the given dimensions centered at (0, 0) */
+List *circle_init(double radius) {
+    List *shape = list_init(POINTS_IN_CIRCLE, free);
+    for (int i = 0; i < POINTS_IN_CIRCLE; i++) {
+        double angle = 2.0 * M_PI * i / POINTS_IN_CIRCLE;
+        Vector p = {radius * cos(angle), radius * sin(angle)};
+        list_add(shape, vp_init(p));
+    }
+    return shape;
+}
+
+/* Returns the body's body type. */
+BodyType get_body_type(Body *body) {
+    BodyInfo *info = body_get_info(body);
+    return info->type;
+}
+
+/* Returns the body's body type as a scene type index. */
+size_t get_body_type_index(Body *body) {
+    return get_body_type(body);
+}
+
+/* Returns the ball's BallInfo. */
+BallInfo *get_ball_info(Body *ball) {
+    BodyInfo *info = body_get_info(ball);
+    assert(info->type == BALL);
+    return info->aux;
+}
+
+/* Returns the current status of the ball. */
+BallStatus get_ball_status(Body *ball) {
+    return get_ball_info(ball)->status;
+}
+
+/* Changes ball status in ball's BodyInfo and keeps the per-status ball counts
+ * in game_state up to date.
+ */
+void set_ball_status(Body *ball, BallStatus status) {
+    BallInfo *info = get_ball_info(ball);
+    assert(game_state.ball_counts[info->status] > 0);
+    game_state.ball_counts[info->status]--;
+    game_state.ball_counts[status]++;
+    info->status = status;
+}
+
+/* Return ball.
+ * This function relies on the initialization of the scene adding ball as the
+ * third body to its list of bodies.
+ */
+Body *get_ball(Scene *s) {
+    return scene_get_body(s, 2);
+}
+
+/* Return trajectory.
+ * This function relies on the initialization of the scene adding trajectory as
+ * the second body to its list of bodies.
+ */
+Body *get_trajectory(Scene *s) {
+    return scene_get_body(s, 1);
+}
+
+/* Returns the cell at the given row (counting down from the top of the
+ * screen) and column of the grid.
+ */
+Body **grid_cell(size_t row, size_t col) {
+    assert(row < GRID_ROWS && col < N_COLS);
+    size_t ring_row = (game_state.grid.top + row) % GRID_ROWS;
+    return &game_state.grid.cells[ring_row * N_COLS + col];
+}
+
+/* Returns the position of the center of a cell. */
+Vector grid_cell_center(size_t row, size_t col) {
+    double x = (BRICK_TOTAL_WIDTH / 2) + col * BRICK_TOTAL_WIDTH;
+    double y = HEIGHT - BRICK_TOTAL_HEIGHT / 2 - row * BRICK_TOTAL_HEIGHT;
+    return (Vector) {x, y};
+}
+
+/* Puts a body in an empty cell and moves it to the cell's center. */
+void grid_place(Body *body, size_t row, size_t col) {
+    Body **cell = grid_cell(row, col);
+    assert(*cell == NULL);
+    *cell = body;
+    body_set_centroid(body, grid_cell_center(row, col));
+}
+
+/* Takes a body out of the cell it is centered on, if it is still there. Call
+ * this whenever a brick or collectible is removed or leaves the board.
+ */
+void grid_forget(Body *body) {
+    Vector pos = body_get_centroid(body);
+    double row = round((HEIGHT - BRICK_TOTAL_HEIGHT / 2 - pos.y)
+        / BRICK_TOTAL_HEIGHT);
+    double col = floor(pos.x / BRICK_TOTAL_WIDTH);
+    if (row < 0 || row >= GRID_ROWS || col < 0 || col >= N_COLS) {
+        return;
+    }
+    Body **cell = grid_cell(row, col);
+    if (*cell == body) {
+        *cell = NULL;
+    }
+}
+
+/* Moves every body on the board down a row. Bodies in the bottom row, which
+ * only ever holds collectibles, drop off the board and are removed.
+ */
+void grid_advance() {
+    for (size_t j = 0; j < N_COLS; j++) {
+        Body **cell = grid_cell(GRID_ROWS - 1, j);
+        if (*cell) {
+            body_remove(*cell);
+            *cell = NULL;
+        }
+    }
+    // The emptied bottom row becomes the new top row. Bodies keep their
+    // shapes in world space, so each is shifted down by one row's height.
+    game_state.grid.top = (game_state.grid.top + GRID_ROWS - 1) % GRID_ROWS;
+    Vector stride = {0, -BRICK_TOTAL_HEIGHT};
+    for (size_t i = 1; i < GRID_ROWS; i++) {
+        for (size_t j = 0; j < N_COLS; j++) {
+            Body *b = *grid_cell(i, j);
+            if (b) {
+                body_set_centroid(b, vec_add(body_get_centroid(b), stride));
+            }
+        }
+    }
+}
+
+/* Forgets the path of the last volley. */
+void reset_path() {
+    Path *path = &game_state.path;
+    path->n_segments = 0;
+    path->n_stale = 0;
+    path->recorder = NULL;
+    path->end_time = INFINITY;
+    path->stale_leader = NULL;
+}
+
+/* Appends a segment to the volley's path. */
+void add_segment(Segment segment) {
+    Path *path = &game_state.path;
+    if (path->n_segments == path->max_segments) {
+        path->max_segments *= 2;
+        path->segments = realloc(path->segments,
+            sizeof(Segment) * path->max_segments);
+        assert(path->segments);
+    }
+    path->segments[path->n_segments++] = segment;
+}
+
+/* Returns where a ball moving along segment is at the given time. */
+Vector segment_pos(Segment *segment, double time) {
+    double t = time - segment->time;
+    return vec_add(segment->pos, vec_multiply(t, segment->velocity));
+}
+
+/* Returns the time at which a ball moving along segment reaches pos, by the
+ * distance it has covered since the segment started.
+ */
+double segment_time(Segment *segment, Vector pos) {
+    double distance = vec_norm(vec_subtract(pos, segment->pos));
+    return segment->time + distance / vec_norm(segment->velocity);
+}
+
+/* Makes a ball that was replaying the path collide again from where it is. */
+void stop_replaying(Body *ball) {
+    get_ball_info(ball)->replaying = false;
+    body_set_collidable(ball, true);
+}
+
+/* Cuts the volley's path before the given segment. Balls already replaying
+ * past the cut keep the segments after it until the end of the tick, so
+ * replay_path() can catch them up to where they are and then have them leave
+ * the path. Balls on the last of those segments wait for the recording ball's
+ * next contact, if there was one, since the path past it isn't known yet.
+ */
+void cut_path(size_t index) {
+    Path *path = &game_state.path;
+    if (index >= path->n_segments) {
+        return;
+    }
+    if (path->n_segments > path->n_stale) {
+        path->n_stale = path->n_segments;
+        path->stale_leader = path->recorder;
+        path->stale_end = path->end_time;
+        if (path->recorder) {
+            BallInfo *info = get_ball_info(path->recorder);
+            Segment *last = &path->segments[path->n_segments - 1];
+            info->off = (Segment) {last->time, last->pos, last->velocity,
+                {NULL}, 0};
+            info->leading = true;
+        }
+    }
+    path->end_time = path->segments[index].time;
+    path->n_segments = index;
+    path->recorder = NULL;
+}
+
+/* Cuts the volley's path at its first contact with a brick being destroyed,
+ * since balls will pass through where it was from then on. The brick is also
+ * cleared from the contacts of every segment, including the stale segments of
+ * earlier cuts, since it is freed before replay_path() reaches them.
+ */
+void forget_brick(Body *brick) {
+    Path *path = &game_state.path;
+    size_t end = path->n_stale > path->n_segments
+        ? path->n_stale : path->n_segments;
+    for (size_t i = 1; i < end; i++) {
+        Segment *segment = &path->segments[i];
+        for (size_t j = 0; j < segment->n_contacts; j++) {
+            if (segment->contacts[j] != brick) {
+                continue;
+            }
+            segment->contacts[j] = NULL;
+            if (i < path->n_segments) {
+                cut_path(i);
+            }
+        }
+    }
+}
+
+/* Records that the ball recording the path hit body, which changed its
+ * velocity by dv. Contacts in the same batch of collisions happen at the same
+ * place, so they are merged into one segment.
+ */
+void record_contact(Body *ball, Body *body, Vector dv) {
+    Path *path = &game_state.path;
+    assert(path->n_segments > 0);
+    Segment *last = &path->segments[path->n_segments - 1];
+    Vector pos = body_get_centroid(ball);
+    if (path->n_segments > 1 && vec_equal(pos, last->pos)) {
+        if (last->n_contacts == MAX_CONTACTS) {
+            // Too many to replay; let balls collide from here on
+            cut_path(path->n_segments - 1);
+            return;
+        }
+        last->contacts[last->n_contacts++] = body;
+        last->velocity = vec_add(last->velocity, dv);
+        return;
+    }
+    Segment next = {
+        .time = segment_time(last, pos),
+        .pos = pos,
+        .velocity = vec_add(body_get_velocity(ball), dv),
+        .contacts = {body},
+        .n_contacts = 1
+    };
+    add_segment(next);
+}
+
+/* Records the contact of a ball that balls off the path are waiting for, the
+ * first one since it left the path, so they collide again there. Contacts in
+ * the same batch of collisions happen at the same place.
+ */
+void record_lead(Body *ball) {
+    BallInfo *info = get_ball_info(ball);
+    Vector pos = body_get_centroid(ball);
+    if (!info->leading || vec_equal(pos, info->off.pos)) {
+        return;
+    }
+    info->release = info->off;
+    info->release.time = segment_time(&info->off, pos);
+    info->release.pos = pos;
+    info->leading = false;
+}
+
+/* Starts the volley's path with a ball that was just shot, or has the ball
+ * replay the path if it was shot the same way as the first ball. Does nothing
+ * if replay is off.
+ */
+void start_path(Body *ball) {
+    Path *path = &game_state.path;
+    if (!game_state.replay) {
+        return;
+    }
+    Vector pos = body_get_centroid(ball);
+    Vector v = body_get_velocity(ball);
+    if (path->n_segments == 0) {
+        add_segment((Segment) {0.0, pos, v, {NULL}, 0});
+        path->recorder = ball;
+        return;
+    }
+    Segment *first = &path->segments[0];
+    if (!vec_equal(pos, first->pos) || !vec_equal(v, first->velocity)) {
+        return;
+    }
+    BallInfo *info = get_ball_info(ball);
+    info->replaying = true;
+    info->segment = 0;
+    info->time = 0.0;
+    body_set_collidable(ball, false);
+}
+
+/* Adds the left and right halves of a broken brick as debris prototypes. */
+void add_debris_prototypes(void) {
+    double h = BRICK_HEIGHT;
+    double w = BRICK_WIDTH;
+
+    List *l = list_init(13, free);
+    List *r = list_init(16, free);
+
+    // 13 pts for the left half
+    list_add(l, vp_init((Vector) {-8.0/16.0 * w, -5.0/10.0 * h}));
+    list_add(l, vp_init((Vector) {-10.0/16.0 * w, 2.0/10.0 * h}));
+    list_add(l, vp_init((Vector) {-7.0/16.0 * w, 4.0/10.0 * h}));
+    list_add(l, vp_init((Vector) {-3.0/16.0 * w, 5.0/10.0 * h}));
+    list_add(l, vp_init((Vector) {0, 6.0/10.0 * h }));
+    list_add(l, vp_init((Vector) {1.0/16.0 * w, 3.0/10.0 * h}));
+    list_add(l, vp_init((Vector) {2.0/16.0 * w, 2.0/10.0 * h}));
+    list_add(l, vp_init((Vector) {1.0/16.0 * w, 1.0/10.0 * h}));
+    list_add(l, vp_init((Vector) {2.0/16.0 * w, 0}));
+    list_add(l, vp_init((Vector) {1.0/16.0 * w, -1.0/10.0 * h}));
+    list_add(l, vp_init((Vector) {2.0/16.0 * w, -2.0/10.0 * h}));
+    list_add(l, vp_init((Vector) {-1.0/16.0 * w, -3.0/10.0 * h}));
+    list_add(l, vp_init((Vector) {-5.0/16.0 * w, -4.0/10.0 * h}));
+
+    // 16 pts for the right half
+    list_add(r, vp_init((Vector) {3.0/16.0 * w, 6.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {5.0/16.0 * w, 6.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {6.0/16.0 * w, 5.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {8.0/16.0 * w, 5.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {9.0/16.0 * w, 4.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {8.0/16.0 * w, 3.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {8.0/16.0 * w, 1.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {7.0/16.0 * w, 0 }));
+    list_add(r, vp_init((Vector) {7.0/16.0 * w, -2.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {6.0/16.0 * w, -3.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {4.0/16.0 * w, -2.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {5.0/16.0 * w, -1.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {4.0/16.0 * w, 0}));
+    list_add(r, vp_init((Vector) {5.0/16.0 * w, 1.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {3.0/16.0 * w, -3.0/10.0 * h}));
+    list_add(r, vp_init((Vector) {4.0/16.0 * w, -4.0/10.0 * h}));
+
+    game_state.debris_left =
+        particles_add_prototype(game_state.debris, l, WHITE);
+    game_state.debris_right =
+        particles_add_prototype(game_state.debris, r, WHITE);
+}
+
+/* Animates destruction of a brick with debris that falls off the screen. */
+void animate_destruction(Body *brick) {
+    Vector brick_loc = body_get_centroid(brick);
+    double fall_time = brick_loc.y / VELOCITY.y;
+    particles_add(game_state.debris, game_state.debris_left, brick_loc,
+        vec_negate(VELOCITY), fall_time);
+    particles_add(game_state.debris, game_state.debris_right, brick_loc,
+        vec_negate(VELOCITY), fall_time);
+}
+
+/* Damages brick that collides with ball, and destroys the brick if it has 0
+ * health left. Ball is unaffected.
+ */
+void damage_collision_handler(Body *brick, Body *ball, Vector axis, void *aux) {
+    BodyInfo *body_info = body_get_info(brick);
+    BrickInfo *info = body_info->aux;
+    info->health--;
+
+    if (info->health <= 0) {
+        forget_brick(brick);
+        grid_forget(brick);
+        animate_destruction(brick);
+        body_remove(brick);
+        return;
+    }
+
+    // Reflect changes in brick color
+    double brightness = (double)info->health / (double)info->level;
+    double r = 1 - (1 - BRICK_COLOR.r) * brightness;
+    double g = 1 - (1 - BRICK_COLOR.g) * brightness;
+    double b = 1 - (1 - BRICK_COLOR.b) * brightness;
+    RGBColor color = {r, g, b};
+    body_set_color(brick, color);
+}
+
+/* Moves life to an extra life on the side of the scene. Auxiliary value aux
+ * should hold a pointer to scene.
+ */
+void life_collision_handler(Body *life, Body *ball, Vector axis,
+                                    void *aux) {
+    Scene *s = aux;
+    if (get_body_type(life) == C_LIFE) {
+        grid_forget(life);
+        BodyInfo *info = body_get_info(life);
+        *info = (BodyInfo){LIFE, NULL, NULL};
+        scene_retype_body(s, life, C_LIFE);
+
+        body_set_velocity(life, (Vector) {0.0, 0.0});
+        double x = WIDTH * 1.05;
+        double y = HEIGHT - (BRICK_TOTAL_HEIGHT) * game_state.lives;
+        tweens_add(game_state.tweens, life,
+            (Vector) {x, y - BRICK_TOTAL_HEIGHT / 2}, LIFE_MOVE_TIME,
+            NULL, NULL);
+        game_state.lives++;
+    }
+}
+
+/* Bomb powerup destroys all bricks */
+void bomb_collision_handler(Body *bomb, Body *ball, Vector axis,
+                                    void *aux) {
+    for (size_t i = 0; i < GRID_ROWS; i++) {
+        for (size_t j = 0; j < N_COLS; j++) {
+            Body **cell = grid_cell(i, j);
+            if (*cell && get_body_type(*cell) == BRICK) {
+                forget_brick(*cell);
+                animate_destruction(*cell);
+                body_remove(*cell);
+                *cell = NULL;
+            }
+        }
+    }
+    grid_forget(bomb);
+    body_remove(bomb);
+}
+
+void collect_collision_handler(Body *c_ball, Body *ball, Vector axis, void *aux) {
+    if (get_ball_status(c_ball) == WAITING && get_ball_status(ball) == READY) {
+        body_set_centroid(c_ball, body_get_centroid(ball));
+        body_set_velocity(c_ball, (Vector) {0.0, 0.0});
+        set_ball_status(c_ball, READY);
+    }
+}
+
+/* Convert collectible ball to ball and drop to the floor. Auxiliary value
+ * aux should contain a pointer to the scene.
+ */
+void collectible_collision_handler(Body *c_ball, Body *ball, Vector axis,
+                                    void *aux) {
+    Scene *s = aux;
+
+    // Convert collectible ball to ball
+    Body *new_ball = generate_ball();
+    body_set_centroid(new_ball, body_get_centroid(c_ball));
+    grid_forget(c_ball);
+    body_remove(c_ball);
+    set_ball_status(new_ball, BOUNCING);
+    scene_add_body(s, new_ball);
+    add_ball_forces(s, new_ball);
+
+    // Drop to the floor
+    body_set_color(new_ball, BALL_COLOR);
+    body_set_velocity(new_ball, vec_negate(VELOCITY));
+}
+
+/* Collects a bouncing ball that reached the floor, which ends the volley's
+ * path if the ball was recording it.
+ */
+void floor_collision_handler(Body *floor, Body *ball, Vector axis, void *aux) {
+    if (get_ball_status(ball) == BOUNCING) {
+        if (ball == game_state.path.recorder) {
+            record_contact(ball, floor, VEC_ZERO);
+            game_state.path.recorder = NULL;
+        }
+        else {
+            record_lead(ball);
+        }
+        collect_ball(ball);
+    }
+}
+
+/* Bounces a ball off a brick or wall, and records the bounce if the ball is
+ * recording the volley's path or was until it was cut.
+ */
+void bounce_collision_handler(Body *body, Body *ball, Vector axis,
+                                void *aux) {
+    Vector v = vec_subtract(body_get_velocity(body), body_get_velocity(ball));
+    Vector dv = vec_multiply((1 + ELASTICITY) * vec_dot(v, axis), axis);
+    body_add_impulse(ball, vec_multiply(body_get_mass(ball), dv));
+    if (ball == game_state.path.recorder) {
+        record_contact(ball, body, dv);
+    }
+    else {
+        record_lead(ball);
+    }
+}
+
+/* Creates a bounce collision force between a brick or wall and a ball. */
+void create_bounce_collision(Scene *s, Body *body, Body *ball) {
+    create_collision(s, body, ball, bounce_collision_handler, NULL, NULL);
+}
+
+/* Creates a damage collision force between brick and ball. */
+void create_damage_collision(Scene *s, Body *brick, Body *ball) {
+    create_collision(s, brick, ball, damage_collision_handler, NULL, NULL);
+}
+
+/* Creates a collectible (ball) collision force between a collectible ball and
+ * a ball.*/
+void create_collectible_collision(Scene *s, Body *c_ball, Body *ball) {
+    create_collision(s, c_ball, ball, collectible_collision_handler, s, NULL);
+}
+
+/* Creates a life collision force between a life collectible and a ball. */
+void create_life_collision(Scene *s, Body *life, Body *ball) {
+    create_collision(s, life, ball, life_collision_handler, s, NULL);
+}
+
+/* Creates a bomb collision force between a bomb collectible and a ball. */
+void create_bomb_collision(Scene *s, Body *bomb, Body *ball) {
+    create_collision(s, bomb, ball, bomb_collision_handler, NULL, NULL);
+}
+
+/* Creates a floor collision force between the floor and a ball. */
+void create_floor_collision(Scene *s, Body *floor, Body *ball) {
+    create_collision(s, floor, ball, floor_collision_handler, NULL, NULL);
+}
+
+
+/* Creates bounce and damage collision forces between ball and all bricks,
+ * collectible forces between ball and all collectible items (not ball),
+ * bounce collision forces between ball and walls, and a floor collision
+ * force between ball and the floor.
+ */
+void add_ball_forces(Scene *s, Body *ball) {
+    for (size_t i = 0; i < scene_bodies_of_type(s, BRICK); i++) {
+        Body *b = scene_get_body_of_type(s, BRICK, i);
+        create_bounce_collision(s, b, ball);
+        create_damage_collision(s, b, ball);
+    }
+    for (size_t i = 0; i < scene_bodies_of_type(s, C_BALL); i++) {
+        create_collectible_collision(s, scene_get_body_of_type(s, C_BALL, i),
+            ball);
+    }
+    for (size_t i = 0; i < scene_bodies_of_type(s, C_LIFE); i++) {
+        create_life_collision(s, scene_get_body_of_type(s, C_LIFE, i), ball);
+    }
+    for (size_t i = 0; i < scene_bodies_of_type(s, C_BOMB); i++) {
+        create_bomb_collision(s, scene_get_body_of_type(s, C_BOMB, i), ball);
+    }
+    for (size_t i = 0; i < scene_bodies_of_type(s, WALL); i++) {
+        create_bounce_collision(s, scene_get_body_of_type(s, WALL, i), ball);
+    }
+    for (size_t i = 0; i < scene_bodies_of_type(s, FLOOR); i++) {
+        create_floor_collision(s, scene_get_body_of_type(s, FLOOR, i), ball);
+    }
+}
+
+/* Creates collision forces between a brick and all balls. */
+void add_brick_forces(Scene *s, Body *brick) {
+    for (size_t i = 0; i < scene_bodies_of_type(s, BALL); i++) {
+        Body *b = scene_get_body_of_type(s, BALL, i);
+        create_bounce_collision(s, brick, b);
+        create_damage_collision(s, brick, b);
+    }
+}
+
+/* Creates collectible_collision forces between a collectible ball and all
+ * balls.
+ */
+void add_collectible_forces(Scene *s, Body *c_ball) {
+    for (size_t i = 0; i < scene_bodies_of_type(s, BALL); i++) {
+        create_collectible_collision(s, c_ball,
+            scene_get_body_of_type(s, BALL, i));
+    }
+}
+
+/* Creates life forces between a life and all balls. */
+void add_life_forces(Scene *s, Body *life) {
+    for (size_t i = 0; i < scene_bodies_of_type(s, BALL); i++) {
+        create_life_collision(s, life, scene_get_body_of_type(s, BALL, i));
+    }
+}
+
+/* Creates bomb forces between a life and all balls. */
+void add_bomb_forces(Scene *s, Body *bomb) {
+    for (size_t i = 0; i < scene_bodies_of_type(s, BALL); i++) {
+        create_bomb_collision(s, bomb, scene_get_body_of_type(s, BALL, i));
+    }
+}
+
+/* Generates a ball with status 'READY'. The ball must be added to the scene,
+ * since it is counted in game_state.
+ */
+Body *generate_ball() {
+    List *circle = circle_init(RADIUS);
+
+    BallInfo *ball_info = malloc(sizeof(BallInfo));
+    assert(ball_info);
+    *ball_info = (BallInfo) {
+        .status = READY,
+        .replaying = false,
+        .leader = NULL,
+        .leading = false
+    };
+    BodyInfo *info = malloc(sizeof(BodyInfo));
+    assert(info);
+    *info = (BodyInfo) {BALL, ball_info, free};
+
+    Body *ball = body_init_with_info(circle, MASS, BALL_COLOR, info,
+                    (FreeFunc) free_body_info);
+    game_state.n_balls++;
+    game_state.ball_counts[READY]++;
+    return ball;
+}
+
+/* Generates a collectible life. */
+Body *generate_life() {
+    // Generate a plus shape
+    List *plus = list_init(12, free);
+    list_add(plus, vp_init((Vector) {LIFE_SIZE * 2 / 3, 0}));
+    list_add(plus, vp_init((Vector) {LIFE_SIZE * 2 / 3, LIFE_SIZE / 3}));
+    list_add(plus, vp_init((Vector) {LIFE_SIZE, LIFE_SIZE / 3}));
+    list_add(plus, vp_init((Vector) {LIFE_SIZE, LIFE_SIZE * 2 / 3}));
+    list_add(plus, vp_init((Vector) {LIFE_SIZE * 2 / 3, LIFE_SIZE * 2 / 3}));
+    list_add(plus, vp_init((Vector) {LIFE_SIZE * 2 / 3, LIFE_SIZE}));
+    list_add(plus, vp_init((Vector) {LIFE_SIZE / 3, LIFE_SIZE}));
+    list_add(plus, vp_init((Vector) {LIFE_SIZE / 3, LIFE_SIZE * 2 / 3}));
+    list_add(plus, vp_init((Vector) {0, LIFE_SIZE * 2 / 3}));
+    list_add(plus, vp_init((Vector) {0, LIFE_SIZE / 3}));
+    list_add(plus, vp_init((Vector) {LIFE_SIZE / 3, LIFE_SIZE / 3}));
+    list_add(plus, vp_init((Vector) {LIFE_SIZE / 3, 0}));
+
+    BodyInfo *info = malloc(sizeof(BodyInfo));
+    assert(info);
+    *info = (BodyInfo){C_LIFE, NULL, NULL};
+
+    Body *ball = body_init_with_info(plus, MASS, LIFE_COLOR, info,
+                    (FreeFunc) free_body_info);
+    return ball;
+}
+
+/**
+ * Helper function that generates one of the points of a 5-pointed star.
+ *
+ * @param radius radius of star
+ * @param i the i-th vertex (convex AND concave) of the star
+ * @return the point as a Vector*
+ */
+Vector *get_pt (double radius, int i) {
+    Vector *v = vp_init((Vector){
+        radius * cos((2.0 * M_PI * i + M_PI / 2) / (10.0)),
+        radius * sin((2.0 * M_PI * i + M_PI / 2) / (10.0))});
+    return v;
+}
+
+/* Generates a 5-pointed star.
+ */
+ List *generate_star() {
+      List *star = list_init(10, free);
+      Vector *v;
+      for (int i = 0; i < 10; i++) {
+         if (i % 2 == 0) {
+             v = get_pt(BOMB_SIZE, i);
+         }
+         else {
+             v = get_pt(BOMB_SIZE / 2.0, i);
+         }
+         list_add(star, v);
+     }
+     return star;
+ }
+
+/* Generates a collectible bomb. */
+Body *generate_bomb() {
+    // Generate a star
+    List *star = generate_star();
+
+    BodyInfo *info = malloc(sizeof(BodyInfo));
+    assert(info);
+    *info = (BodyInfo) {C_BOMB, NULL, NULL};
+
+    Body *ball = body_init_with_info(star, MASS, BOMB_COLOR, info,
+                    (FreeFunc) free_body_info);
+    return ball;
+}
+
+/* Generates a collectible ball. */
+Body *generate_collectible_ball() {
+    List *circle = circle_init(RADIUS);
+
+    BodyInfo *info = malloc(sizeof(BodyInfo));
+    assert(info);
+    *info = (BodyInfo){C_BALL, NULL, NULL};
+
+    Body *ball = body_init_with_info(circle, MASS, C_BALL_COLOR, info,
+                    (FreeFunc) free_body_info);
+    return ball;
+}
+
+/* Generates a brick with given level. Put it on the board with grid_place().
+ */
+Body *generate_brick(size_t level) {
+    assert(level > 0);
+
+    List *shape = rect_init(BRICK_WIDTH, BRICK_HEIGHT);
+
+    BrickInfo *brick_info = malloc(sizeof(BrickInfo));
+    assert(brick_info);
+    BodyInfo *info = malloc(sizeof(BodyInfo));
+    assert(info);
+    *brick_info = (BrickInfo) {level, level};
+    *info = (BodyInfo){BRICK, brick_info, free};
+
+    Body *brick = body_init_with_info(shape, INFINITY, BRICK_COLOR, info,
+                    (FreeFunc) free_body_info);
+    return brick;
+}
+
+/* Generates a body that shows ball's trajectory starting from the position
+ * of the balls. */
+Body *init_trajectory(Vector ball_pos) {
+    List *shape = rect_init(TRAJ_WIDTH, TRAJ_HEIGHT);
+    BodyInfo *info = malloc(sizeof(BodyInfo));
+    assert(info);
+    *info = (BodyInfo){TRAJ, NULL, NULL};
+    Body *traj = body_init_with_info(shape, INFINITY, TRAJ_COLOR, info,
+                    (FreeFunc) free_body_info);
+    body_set_centroid(traj, vec_add(ball_pos, (Vector) {0, TRAJ_HEIGHT / 2}));
+
+    return traj;
+}
+
+/* Add background */
+Body *generate_background() {
+    List *shape = rect_init(WIDTH, HEIGHT);
+    BodyInfo *info = malloc(sizeof(BodyInfo));
+    assert(info);
+    *info = (BodyInfo){MISC, NULL, NULL};
+    Body *background = body_init_with_info(shape, INFINITY, BACKGROUND_COLOR,
+                    info, (FreeFunc) free_body_info);
+    body_set_centroid(background, (Vector) {WIDTH / 2.0, HEIGHT / 2.0});
+
+    return background;
+}
+
+/* Adds a wall of given dimension at centered at position given by centroid to
+ * the scene. The wall collides as a half-plane, with normal pointing into the
+ * screen, so no ball can get through it however fast it goes.
+ */
+void add_wall(Scene *scene, double width, double height, Vector centroid,
+                Vector normal) {
+    List *shape = rect_init(width, height);
+    polygon_translate(shape, centroid);
+    BodyInfo *info = malloc(sizeof(BodyInfo));
+    assert(info);
+    *info = (BodyInfo) {WALL, NULL, NULL};
+    Body *body = body_init_with_info(shape, INFINITY, WALL_COLOR, info,
+                    (FreeFunc) free_body_info);
+    body_set_half_plane(body, normal);
+    scene_add_body(scene, body);
+}
+
+/* Adds the floor below the screen, which collects balls that reach it. */
+void add_floor(Scene *scene) {
+    List *shape = rect_init(WALL_WIDTH, WALL_WIDTH);
+    polygon_translate(shape, (Vector) {WIDTH / 2.0, -WALL_WIDTH / 2.0});
+    BodyInfo *info = malloc(sizeof(BodyInfo));
+    assert(info);
+    *info = (BodyInfo) {FLOOR, NULL, NULL};
+    Body *body = body_init_with_info(shape, INFINITY, WALL_COLOR, info,
+                    (FreeFunc) free_body_info);
+    body_set_half_plane(body, (Vector) {0, 1});
+    scene_add_body(scene, body);
+}
+
+/* Initializes scene for Swipe Break Breaker game with ball and bricks, and
+ * returns the scene.
+ */
+Scene *generate_scene() {
+    Scene *s = scene_init_with_types(N_BODY_TYPES, get_body_type_index);
+
+    Body *background = generate_background();
+    scene_add_body(s, background);
+
+    // Generate a trajectory where ball is
+    Body *traj = init_trajectory((Vector){WIDTH / 2.0 , RADIUS});
+    scene_add_body(s, traj);
+
+    // Generate a ball at bottom center of screen
+    Body *ball = generate_ball();
+    body_set_centroid(ball, (Vector){WIDTH / 2.0 , RADIUS});
+    scene_add_body(s, ball);
+
+    // Generate walls
+    add_wall(s, WIDTH, WALL_WIDTH,
+        (Vector) {WIDTH / 2.0, HEIGHT + WALL_WIDTH / 2.0}, (Vector) {0, -1});
+    add_wall(s, WALL_WIDTH, HEIGHT,
+        (Vector) {-WALL_WIDTH / 2.0, HEIGHT / 2.0}, (Vector) {1, 0});
+    add_wall(s, WALL_WIDTH, HEIGHT,
+        (Vector) {WIDTH + WALL_WIDTH / 2.0, HEIGHT / 2.0}, (Vector) {-1, 0});
+    add_floor(s);
+
+    add_ball_forces(s, ball);
+
+    // Generate a brick to start with
+    RowRecord row;
+    if (game_state.endless) {
+        row = board_row(0);
+    }
+    else {
+        row = (RowRecord) {.health = {0}, .collectible = MISC};
+        row.health[rand_int(0, N_COLS)] = 1;
+    }
+    add_row(s, &row);
+
+    // Balls move in straight lines between collisions, so step from one
+    // predicted collision to the next instead of sampling every frame
+    scene_set_kinetic(s, true);
+
+    return s;
+}
+
+void find_shooting_balls(Scene *s) {
+    for (size_t i = 0; i < scene_bodies_of_type(s, BALL); i++) {
+        list_add(game_state.shoot_balls, scene_get_body_of_type(s, BALL, i));
+    }
+}
+
+/* Shoot a ball stored in the game state's shoot_balls list, and schedules
+ * the next shot if there are balls left. Shots are scheduled from when the
+ * last one was due rather than from the tick that fired it, so they stay
+ * INTERVAL apart whatever the tick length.
+ */
+void shoot_ball(Scene *s) {
+    Body *ball = list_remove(game_state.shoot_balls,
+                            list_size(game_state.shoot_balls) - 1);
+    Vector v = vec_rotate(VELOCITY, body_get_orientation(get_trajectory(s)));
+    body_set_velocity(ball, v);
+    set_ball_status(ball, BOUNCING);
+    start_path(ball);
+    if (list_size(game_state.shoot_balls) > 0) {
+        game_state.next_shot += INTERVAL;
+        timer_wheel_schedule(game_state.timers, game_state.next_shot,
+            (TimerCallback) shoot_ball, s);
+    }
+}
+
+/* Checks if the current round is over (all balls are waiting). */
+bool round_over(Scene *s) {
+    assert(game_state.n_balls == scene_bodies_of_type(s, BALL));
+    return game_state.ball_counts[WAITING] == game_state.n_balls;
+}
+
+/* Stops a bouncing ball and mark its status as 'WAITING'.
+ */
+void wait_ball(Body *ball) {
+    body_set_velocity(ball, VEC_ZERO);
+    set_ball_status(ball, WAITING);
+}
+
+/* Stops a ball on the floor and collects it at ball_loc. The first ball to
+ * land sets ball_loc and waits there; later balls roll towards it.
+ */
+void collect_ball(Body *ball) {
+    // A ball that landed against a wall may be overlapping it, and would then
+    // be shot from inside it
+    Vector pos = body_get_centroid(ball);
+    pos.x = fmax(RADIUS, fmin(pos.x, WIDTH - RADIUS));
+    pos.y = RADIUS;
+    body_set_centroid(ball, pos);
+
+    // Needed for edge case when ball collides a wall simultaneously
+    body_reset_impulse(ball);
+
+    // Collect the ball at ball_loc
+    if (vec_equal(game_state.ball_loc, NULL_BALL_LOC)) {
+        // Set ball_loc and wait the ball
+        game_state.ball_loc = pos;
+        wait_ball(ball);
+    }
+    else {
+        // Ball is left of ball_loc
+        if (pos.x < game_state.ball_loc.x) {
+            body_set_velocity(ball, VELOCITY_RIGHT);
+            set_ball_status(ball, RETURNING);
+            list_add(game_state.rolling, ball);
+        }
+        // Ball is right of ball_loc
+        else if (pos.x > game_state.ball_loc.x) {
+            body_set_velocity(ball, vec_negate(VELOCITY_RIGHT));
+            set_ball_status(ball, RETURNING);
+            list_add(game_state.rolling, ball);
+        }
+        // Ball is at ball_loc
+        else {
+            wait_ball(ball);
+        }
+    }
+}
+
+/* Stops a ball that rolled to ball_loc and marks its status as 'WAITING'. */
+void finish_collection(Body *ball, void *aux) {
+    assert(get_ball_status(ball) == RETURNING);
+    body_set_centroid(ball, game_state.ball_loc);
+    body_set_collidable(ball, true);
+    wait_ball(ball);
+}
+
+/* Tweens the balls that started rolling towards ball_loc this tick the rest
+ * of the way there, out of the scene's collisions. Balls may have started
+ * rolling at any point during the tick, so they are tweened from where they
+ * are at its end.
+ */
+void schedule_collection() {
+    while (list_size(game_state.rolling) > 0) {
+        Body *b = list_remove(game_state.rolling,
+                                list_size(game_state.rolling) - 1);
+        Vector pos = body_get_centroid(b);
+        double t = (game_state.ball_loc.x - pos.x) / body_get_velocity(b).x;
+        if (t <= 0) {
+            finish_collection(b, NULL);     // Already passed ball_loc
+        }
+        else {
+            body_set_velocity(b, VEC_ZERO);
+            body_set_collidable(b, false);
+            tweens_add(game_state.tweens, b, game_state.ball_loc, t,
+                finish_collection, NULL);
+        }
+    }
+}
+
+/* Has a ball that was cut off the path leave it, after the segment it was
+ * on. It keeps moving along that segment until the next contact on it, which
+ * is the next stale segment, the earlier cut the stale segments ended at, or
+ * the next contact of the ball that was recording them.
+ */
+void leave_path(Body *ball) {
+    Path *path = &game_state.path;
+    BallInfo *info = get_ball_info(ball);
+    Segment *curr = &path->segments[info->segment];
+    info->off = (Segment) {curr->time, curr->pos, curr->velocity, {NULL}, 0};
+    info->release = info->off;
+    info->leader = NULL;
+    if (info->segment + 1 < path->n_stale) {
+        Segment *next = &path->segments[info->segment + 1];
+        info->release.time = next->time;
+        info->release.pos = next->pos;
+    }
+    else if (path->stale_leader) {
+        info->leader = path->stale_leader;
+    }
+    else {
+        assert(isfinite(path->stale_end));
+        info->release.time = path->stale_end;
+        info->release.pos = segment_pos(&info->off, path->stale_end);
+    }
+    info->segment = OFF_PATH;
+}
+
+/* Has a ball off the path collide again once it reaches its next contact, with
+ * the velocity it had before it, so the contact happens for real. Until the
+ * contact is known, the ball is kept behind the ball whose contact it is.
+ */
+void replay_off_path(Body *ball) {
+    BallInfo *info = get_ball_info(ball);
+    if (info->leader) {
+        BallInfo *lead = get_ball_info(info->leader);
+        if (lead->leading) {
+            double t = segment_time(&lead->off,
+                body_get_centroid(info->leader));
+            if (info->time > t) {
+                info->time = t;
+                body_set_centroid(ball, segment_pos(&info->off, t));
+            }
+            return;
+        }
+        info->release.time = lead->release.time;
+        info->release.pos = lead->release.pos;
+        info->leader = NULL;
+    }
+    if (info->time >= info->release.time) {
+        body_set_centroid(ball, info->release.pos);
+        body_set_velocity(ball, info->off.velocity);
+        stop_replaying(ball);
+    }
+}
+
+/* Advances the balls replaying the volley's path by dt. Balls that reached
+ * the next segment are moved onto it exactly, damaging the bricks they hit
+ * there; balls that reached the floor are collected. Balls that were past a
+ * cut made this tick finish replaying the segments they reached, then leave
+ * the path, see leave_path().
+ */
+void replay_path(Scene *s, double dt) {
+    Path *path = &game_state.path;
+    for (size_t i = 0; i < scene_bodies_of_type(s, BALL); i++) {
+        Body *b = scene_get_body_of_type(s, BALL, i);
+        BallInfo *info = get_ball_info(b);
+        if (!info->replaying) {
+            continue;
+        }
+        info->time += dt;
+        if (info->segment == OFF_PATH) {
+            replay_off_path(b);
+            continue;
+        }
+        bool past_cut = info->segment >= path->n_segments;
+        size_t n_segments = past_cut ? path->n_stale : path->n_segments;
+
+        // Only move balls that reached a contact, so they keep their motion
+        // (and kinetic predictions) otherwise
+        bool moved = false;
+        bool landed = false;
+        Segment curr = path->segments[info->segment];
+        while (info->replaying && !landed
+                && info->segment + 1 < n_segments
+                && path->segments[info->segment + 1].time <= info->time) {
+            info->segment++;
+            curr = path->segments[info->segment];
+            body_set_centroid(b, curr.pos);
+            body_set_velocity(b, curr.velocity);
+            moved = true;
+            for (size_t j = 0; j < curr.n_contacts; j++) {
+                // Destroyed bricks were cleared by forget_brick()
+                Body *body = curr.contacts[j];
+                if (body == NULL) {
+                    continue;
+                }
+                if (get_body_type(body) == BRICK && !body_is_removed(body)) {
+                    damage_collision_handler(body, b, VEC_ZERO, NULL);
+                }
+                else if (get_body_type(body) == FLOOR) {
+                    landed = true;
+                }
+            }
+        }
+        if (landed) {
+            stop_replaying(b);
+            collect_ball(b);
+            continue;
+        }
+
+        if (!past_cut && info->segment < path->n_segments
+            && info->time >= path->end_time) {
+            // Collide again from the cut itself, a little late, so the ball
+            // meets whatever else was hit there as the first ball did
+            body_set_centroid(b, segment_pos(&curr, path->end_time));
+            stop_replaying(b);
+            if (path->recorder == NULL) {
+                path->recorder = b;
+            }
+            continue;
+        }
+        if (path->recorder && info->segment + 1 == path->n_segments) {
+            // The path past the recording ball isn't known yet
+            double t = segment_time(&curr,
+                body_get_centroid(path->recorder));
+            if (info->time > t) {
+                info->time = t;
+                moved = true;
+            }
+        }
+        if (moved) {
+            body_set_centroid(b, segment_pos(&curr, info->time));
+        }
+    }
+
+    // The segments past the cut will be recorded over
+    for (size_t i = 0; i < scene_bodies_of_type(s, BALL); i++) {
+        Body *b = scene_get_body_of_type(s, BALL, i);
+        BallInfo *info = get_ball_info(b);
+        if (info->replaying && info->segment != OFF_PATH
+            && info->segment >= path->n_segments) {
+            leave_path(b);
+            replay_off_path(b);
+        }
+    }
+    path->n_stale = 0;
+}
+
+/* Draws a random row of bricks with the given level, with one collectible in a
+ * column without a brick.
+ */
+RowRecord draw_row(size_t level) {
+    RowRecord row;
+    bool cols[N_COLS];
+    choose_cols(cols);
+    int powerup_col = rand_int(0, N_COLS);
+    assert(0 <= powerup_col && powerup_col < N_COLS);
+    cols[powerup_col] = 0;
+
+    for (size_t j = 0; j < N_COLS; j++) {
+        row.health[j] = cols[j] ? level : 0;
+    }
+
+    double powerup_probability = rand_num();
+    if (powerup_probability < LIFE_PROB) {
+        row.collectible = C_LIFE;
+    }
+    else if (powerup_probability < LIFE_PROB + BOMB_PROB) {
+        row.collectible = C_BOMB;
+    }
+    else {
+        row.collectible = C_BALL;
+    }
+    row.collectible_col = powerup_col;
+    return row;
+}
+
+/* Returns the row with the given index on the endless board, counting from
+ * the first row of the game. Rows above the screen aren't stored anywhere:
+ * each one is drawn from its own random stream, seeded by the board's seed and
+ * the row's index, when it scrolls onto the screen. So the board is the same
+ * however the game is played, and it takes no memory however long it is.
+ */
+RowRecord board_row(size_t index) {
+    uint64_t stream = game_state.board_seed ^ (index * 0xD1B54A32D192ED03ull);
+    game_state.row_stream = &stream;
+    RowRecord row = draw_row(index + 1);
+    game_state.row_stream = NULL;
+    return row;
+}
+
+/* Adds the bodies of a row to the top row of the grid with their forces. */
+void add_row(Scene *s, RowRecord *row) {
+    for (size_t j = 0; j < N_COLS; j++) {
+        if (row->health[j] > 0) {
+            Body *brick = generate_brick(row->health[j]);
+            grid_place(brick, 0, j);
+            add_brick_forces(s, brick);
+            scene_add_body(s, brick);
+        }
+    }
+
+    Body *collectible;
+    switch (row->collectible) {
+        case C_LIFE:
+            collectible = generate_life();
+            add_life_forces(s, collectible);
+            break;
+        case C_BOMB:
+            collectible = generate_bomb();
+            add_bomb_forces(s, collectible);
+            break;
+        case C_BALL:
+            collectible = generate_collectible_ball();
+            add_collectible_forces(s, collectible);
+            break;
+        default:
+            return;
+    }
+    grid_place(collectible, 0, row->collectible_col);
+    scene_add_body(s, collectible);
+}
+
+/* Prepare for next round.
+ * 1) Adds a row of bricks with the given level to the scene.
+ *    The row would consist of one to five bricks, decided randomly.
+ * 2) Add a new ball to collect at a random place
+ * 3) Reset ball_loc and mark all balls as ready.
+ * 4) Activate trajectory and enable player.
+ *
+ * Returns false if game is over because the newly added row touches the ground.
+ */
+bool next_round(Scene *s, size_t level) {
+    bool life_used = false;
+
+    // Shift all existing bricks and collectibles 1 row down
+    grid_advance();
+
+    // Bricks that reached the bottom row touch the ground
+    for (size_t j = 0; j < N_COLS; j++) {
+        Body **cell = grid_cell(GRID_ROWS - 1, j);
+        if (*cell && get_body_type(*cell) == BRICK) {
+            // Use life or game over
+            if (game_state.lives > 0) {
+                life_used = true;
+                body_remove(*cell);
+                *cell = NULL;
+            }
+            else {
+                return false;   // Game over
+            }
+        }
+    }
+
+    if (life_used) {
+        use_life(s);
+    }
+
+    // Add a new row of bricks
+    RowRecord row = game_state.endless ? board_row(level - 1) : draw_row(level);
+    add_row(s, &row);
+
+    // Reset ball_loc
+    game_state.ball_loc = NULL_BALL_LOC;
+
+    // Mark all balls as ready
+    for (size_t i = 0; i < scene_bodies_of_type(s, BALL); i++) {
+        Body *b = scene_get_body_of_type(s, BALL, i);
+        assert(get_ball_status(b) == WAITING);
+        set_ball_status(b, READY);
+    }
+
+    // Activate trajectory where balls are
+    body_set_color(get_trajectory(s), TRAJ_COLOR);
+    game_state.player_enabled = true;
+
+    return true;
+}
+
+/* Places where balls are collected and resets the angle. */
+void reset_trajectory(Scene *s) {
+    Body *traj = get_trajectory(s);
+    Vector ball_loc = body_get_centroid(get_ball(s)); // get first ball
+    Vector v = vec_add(ball_loc, (Vector){0, TRAJ_HEIGHT / 2});
+    body_set_centroid(traj, v);
+    body_set_rotation(traj, 0, ball_loc);
+}
+
+/* Use the collected life. Only call this function if there are lives left. */
+void use_life(Scene *s) {
+    size_t n_lives = scene_bodies_of_type(s, LIFE);
+    assert(n_lives > 0);
+    body_remove(scene_get_body_of_type(s, LIFE, n_lives - 1));
+    game_state.lives--;
+}
+
+/* Starts a new game, on the endless board with the given seed if endless is
+ * true.
+ */
+Scene *init_game(bool endless, uint64_t board_seed) {
+    // Initialize global game state before any balls are generated
+    game_state.player_enabled = true;
+    game_state.lives = 0;
+    game_state.shoot_balls = list_init(1, NULL);
+    game_state.ball_loc = NULL_BALL_LOC;
+    game_state.n_balls = 0;
+    memset(game_state.ball_counts, 0, sizeof(game_state.ball_counts));
+    game_state.level = 1;
+    game_state.time = 0;
+    game_state.next_shot = 0;
+    game_state.timers = timer_wheel_init(TIMER_RESOLUTION);
+    game_state.tweens = tweens_init(1);
+    game_state.rolling = list_init(1, NULL);
+    game_state.debris = particles_init(N_COLS * 2);
+    add_debris_prototypes();
+    game_state.path.segments = malloc(sizeof(Segment) * SEGMENTS);
+    assert(game_state.path.segments);
+    game_state.path.max_segments = SEGMENTS;
+    reset_path();
+    game_state.replay = true;
+    memset(game_state.grid.cells, 0, sizeof(game_state.grid.cells));
+    game_state.grid.top = 0;
+    game_state.endless = endless;
+    game_state.board_seed = board_seed;
+    game_state.row_stream = NULL;
+
+    return generate_scene();
+}
+
+Scene *breaker_init(void) {
+    return init_game(false, 0);
+}
+
+Scene *breaker_init_endless(unsigned int board_seed) {
+    return init_game(true, board_seed);
+}
+
+void breaker_free(Scene *s) {
+    scene_free(s);
+    list_free(game_state.shoot_balls);
+    free(game_state.path.segments);
+    timer_wheel_free(game_state.timers);
+    tweens_free(game_state.tweens);
+    list_free(game_state.rolling);
+    particles_free(game_state.debris);
+}
+
+bool breaker_player_enabled(void) {
+    return game_state.player_enabled;
+}
+
+double breaker_get_aim(Scene *s) {
+    return body_get_orientation(get_trajectory(s));
+}
+
+void breaker_set_aim(Scene *s, double angle) {
+    // Don't do anything if player is disabled
+    if (!game_state.player_enabled) {
+        return;
+    }
+    if (angle > MAX_AIM) {
+        angle = MAX_AIM;
+    }
+    else if (angle < -MAX_AIM) {
+        angle = -MAX_AIM;
+    }
+    Vector ball_loc = body_get_centroid(get_ball(s));
+    body_set_rotation(get_trajectory(s), angle, ball_loc);
+}
+
+void breaker_shoot(Scene *s) {
+    if (!game_state.player_enabled) {
+        return;
+    }
+    // Shoot balls from the next tick on and disable player / trajectory.
+    reset_path();
+    find_shooting_balls(s);
+    game_state.next_shot = game_state.time;
+    timer_wheel_schedule(game_state.timers, game_state.next_shot,
+        (TimerCallback) shoot_ball, s);
+    game_state.player_enabled = false;
+    body_set_color(get_trajectory(s), BACKGROUND_COLOR);
+}
+
+void breaker_set_replay(bool replay) {
+    game_state.replay = replay;
+}
+
+bool breaker_tick(Scene *s, double dt) {
+    // Game has 3 states:
+    // 1) If player's turn, wait for input
+    // 2) bounce
+    // 3) Add row / check game over
+    game_state.time += dt;
+
+    // Shoot balls that are due, and move balls being collected and lives
+    // before the scene frees any removed bodies
+    timer_wheel_advance(game_state.timers, game_state.time);
+    tweens_tick(game_state.tweens, dt);
+    particles_tick(game_state.debris, dt);
+
+    scene_tick(s, dt);
+    replay_path(s, dt);
+    schedule_collection();
+
+    if (round_over(s)) {
+        game_state.level++;
+        if (!next_round(s, game_state.level)) {
+            return false;   // Game over
+        }
+        reset_trajectory(s);
+    }
+    return true;
+}
+
+size_t breaker_get_level(void) {
+    return game_state.level;
+}
+
+bool breaker_is_static(Body *body) {
+    switch (get_body_type(body)) {
+        case BALL:
+        case TRAJ:
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool breaker_get_label(Body *body, size_t *number) {
+    // Destroyed bricks stay in the scene until its next tick
+    if (get_body_type(body) != BRICK || body_is_removed(body)) {
+        return false;
+    }
+    BodyInfo *info = body_get_info(body);
+    *number = ((BrickInfo *) info->aux)->health;
+    return true;
+}
+
+ParticleSystem *breaker_get_debris(void) {
+    return game_state.debris;
+}
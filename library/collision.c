@@ -123,20 +123,113 @@ CollisionInfo check_collisions(List *shape1, List *shape2, double *overlap) {
  *      they're colliding on.
  */
 CollisionInfo find_collision(List *shape1, List *shape2) {
-    double *overlap1 = (double *)malloc(sizeof(double));
-    double *overlap2 = (double *)malloc(sizeof(double));
-    *overlap1 = INFINITY;
-    *overlap2 = INFINITY;
-    CollisionInfo check1 = check_collisions(shape1, shape2, overlap1);
-    CollisionInfo check2 = check_collisions(shape2, shape1, overlap2);
+    double overlap1 = INFINITY;
+    double overlap2 = INFINITY;
+    CollisionInfo check1 = check_collisions(shape1, shape2, &overlap1);
+    CollisionInfo check2 = check_collisions(shape2, shape1, &overlap2);
     CollisionInfo check = (CollisionInfo) {false, VEC_ZERO};
-    if (check1.collided && check2.collided && *overlap1 <= *overlap2) {
+    if (check1.collided && check2.collided && overlap1 <= overlap2) {
         check =  check1;
     }
-    else if (check1.collided && check2.collided && *overlap1 > *overlap2) {
+    else if (check1.collided && check2.collided && overlap1 > overlap2) {
         check =  check2;
     }
-    free(overlap1);
-    free(overlap2);
     return check;
 }
+
+/**
+ * Narrows a time interval down to the times at which the projections of two
+ * shapes onto an axis overlap, as shape2 moves relative to shape1.
+ *
+ * @param axis, unit vector to be projected onto
+ * @param shape1, list of vectors
+ * @param shape2, list of vectors
+ * @param velocity, velocity of shape2 relative to shape1
+ * @param interval, the interval to narrow
+ * @return whether the interval is still non-empty
+ */
+bool narrow_interval(Vector axis, List *shape1, List *shape2, Vector velocity,
+                        CollisionInterval *interval) {
+    Vector v1 = find_polygon_projection(axis, shape1);
+    Vector v2 = find_polygon_projection(axis, shape2);
+    double speed = vec_dot(velocity, axis);
+    if (speed == 0.0) {
+        return v2.x < v1.y && v2.y > v1.x;
+    }
+    double t1 = (v1.x - v2.y) / speed;
+    double t2 = (v1.y - v2.x) / speed;
+    interval->start = max(interval->start, min(t1, t2));
+    interval->end = min(interval->end, max(t1, t2));
+    return interval->start < interval->end;
+}
+
+/**
+ * Narrows a time interval along each edge normal of shape1.
+ *
+ * @param shape1, list of vectors whose edges give the axes
+ * @param shape2, list of vectors
+ * @param velocity, velocity of shape2 relative to shape1
+ * @param interval, the interval to narrow
+ * @return whether the interval is still non-empty
+ */
+bool narrow_by_edges(List *shape1, List *shape2, Vector velocity,
+                        CollisionInterval *interval) {
+    int size = list_size(shape1);
+    for (int i = 0; i < size; i++) {
+        Vector v1 = v_cast(list_get(shape1, i));
+        Vector v2 = v_cast(list_get(shape1, (i + 1) % size));
+        Vector p = find_perpendicular_vector(vec_subtract(v2, v1));
+        if (!narrow_interval(p, shape1, shape2, velocity, interval)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CollisionInterval find_collision_interval(List *shape1, Vector velocity1,
+                                            List *shape2, Vector velocity2) {
+    CollisionInterval interval = {true, -INFINITY, INFINITY};
+    Vector velocity = vec_subtract(velocity2, velocity1);
+    if (!narrow_by_edges(shape1, shape2, velocity, &interval)
+        || !narrow_by_edges(shape2, shape1, vec_negate(velocity), &interval)) {
+        return (CollisionInterval) {false, INFINITY, INFINITY};
+    }
+    return interval;
+}
+
+/**
+ * Returns the signed distance from the edge of a half-plane to the nearest
+ * point of a polygon, which is negative if the polygon crosses the edge.
+ *
+ * @param plane, the half-plane
+ * @param shape, list of vectors
+ * @return the signed distance as a double
+ */
+double half_plane_distance(HalfPlane plane, List *shape) {
+    return find_polygon_projection(plane.normal, shape).x - plane.offset;
+}
+
+CollisionInfo find_half_plane_collision(HalfPlane plane, List *shape) {
+    if (half_plane_distance(plane, shape) < 0.0) {
+        return (CollisionInfo) {true, plane.normal};
+    }
+    return (CollisionInfo) {false, VEC_ZERO};
+}
+
+CollisionInterval find_half_plane_interval(HalfPlane plane, List *shape,
+                                            Vector velocity) {
+    double distance = half_plane_distance(plane, shape);
+    double speed = vec_dot(velocity, plane.normal);
+    if (speed == 0.0) {
+        if (distance < 0.0) {
+            return (CollisionInterval) {true, -INFINITY, INFINITY};
+        }
+        return (CollisionInterval) {false, INFINITY, INFINITY};
+    }
+    // The polygon crosses the edge at this time, entering if speed < 0
+    double t = -distance / speed;
+    if (speed < 0.0) {
+        return (CollisionInterval) {true, t, INFINITY};
+    }
+    return (CollisionInterval) {true, -INFINITY, t};
+}
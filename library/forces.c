@@ -14,6 +14,7 @@
 typedef struct collision_aux {
     CollisionHandler handler;
     bool prev_collided;
+    Vector axis;        // Collision axis found by the last collision test
     void *aux;
     FreeFunc aux_freer;
 } CollisionAux;
@@ -104,22 +105,96 @@ void drag_forcer(List *bodies, void *aux) {
     body_add_force(b, force);
 }
 
-/* Takes a list of two bodies and an auxiliary value holding a CollisionHandler
- * and calls the given CollisionHandler on the bodies.
+/* Computes the status of the collision between two bodies, using a signed
+ * distance test if one of them is a half-plane.
  */
-void collision_forcer(List *bodies, void *aux) {
+CollisionInfo find_body_collision(Body *b1, Body *b2) {
+    HalfPlane plane;
+    if (body_get_half_plane(b1, &plane)) {
+        return find_half_plane_collision(plane, body_borrow_shape(b2));
+    }
+    if (body_get_half_plane(b2, &plane)) {
+        CollisionInfo info = find_half_plane_collision(plane,
+            body_borrow_shape(b1));
+        info.axis = vec_negate(info.axis);
+        return info;
+    }
+    return find_collision(body_borrow_shape(b1), body_borrow_shape(b2));
+}
+
+/* Computes when two bodies overlap if both keep their current velocities. */
+CollisionInterval find_body_interval(Body *b1, Body *b2) {
+    HalfPlane plane;
+    Vector velocity = vec_subtract(body_get_velocity(b2),
+        body_get_velocity(b1));
+    if (body_get_half_plane(b1, &plane)) {
+        return find_half_plane_interval(plane, body_borrow_shape(b2),
+            velocity);
+    }
+    if (body_get_half_plane(b2, &plane)) {
+        return find_half_plane_interval(plane, body_borrow_shape(b1),
+            vec_negate(velocity));
+    }
+    return find_collision_interval(body_borrow_shape(b1),
+        body_get_velocity(b1), body_borrow_shape(b2), body_get_velocity(b2));
+}
+
+/* Takes a list of two bodies and an auxiliary value holding a CollisionAux,
+ * and returns whether the bodies just started colliding. Only modifies the
+ * CollisionAux, so it is safe to run concurrently with other testers.
+ */
+bool collision_tester(List *bodies, void *aux) {
     Body *b1 = list_get(bodies, 0);
     Body *b2 = list_get(bodies, 1);
-    List *shape1 = body_get_shape(b1);
-    List *shape2 = body_get_shape(b2);
-    CollisionInfo info = find_collision(shape1, shape2);
-    list_free(shape1);
-    list_free(shape2);
     CollisionAux *collision_aux = (CollisionAux *)aux;
-    if (info.collided && !collision_aux->prev_collided) {
-        collision_aux->handler(b1, b2, info.axis, collision_aux->aux);
+    if (!body_is_collidable(b1) || !body_is_collidable(b2)) {
+        collision_aux->prev_collided = false;
+        return false;
     }
+    CollisionInfo info = find_body_collision(b1, b2);
+    bool started = info.collided && !collision_aux->prev_collided;
     collision_aux->prev_collided = info.collided;
+    collision_aux->axis = info.axis;
+    return started;
+}
+
+/* Takes a list of two bodies and an auxiliary value holding a CollisionAux,
+ * and returns how long until collision_tester() would give a different result
+ * if both bodies keep their current velocities.
+ */
+double collision_predictor(List *bodies, void *aux) {
+    Body *b1 = list_get(bodies, 0);
+    Body *b2 = list_get(bodies, 1);
+    CollisionAux *collision_aux = (CollisionAux *)aux;
+    if (!body_is_collidable(b1) || !body_is_collidable(b2)) {
+        // The tester only has to clear prev_collided
+        return collision_aux->prev_collided ? 0.0 : INFINITY;
+    }
+    CollisionInterval interval = find_body_interval(b1, b2);
+
+    bool overlapping = interval.collides && interval.start < 0
+                        && interval.end > 0;
+    if (overlapping != collision_aux->prev_collided) {
+        return 0.0;
+    }
+    if (overlapping) {
+        return interval.end;
+    }
+    if (interval.collides && interval.end > 0) {
+        return interval.start > 0 ? interval.start : 0.0;
+    }
+    return INFINITY;
+}
+
+/* Takes a list of two bodies and an auxiliary value holding a CollisionAux
+ * and calls the given CollisionHandler on the bodies, along the axis found by
+ * collision_tester().
+ */
+void collision_forcer(List *bodies, void *aux) {
+    Body *b1 = list_get(bodies, 0);
+    Body *b2 = list_get(bodies, 1);
+    CollisionAux *collision_aux = (CollisionAux *)aux;
+    collision_aux->handler(b1, b2, collision_aux->axis, collision_aux->aux);
 }
 
 void create_newtonian_gravity(Scene *scene, double G, Body *body1, Body *body2) {
@@ -128,7 +203,8 @@ void create_newtonian_gravity(Scene *scene, double G, Body *body1, Body *body2)
     List *bodies = list_init(2, NULL);
     list_add(bodies, body1);
     list_add(bodies, body2);
-    scene_add_bodies_force_creator(scene, gravity_forcer, G_ptr, bodies, free);
+    scene_add_parallel_force_creator(scene, gravity_forcer, G_ptr, bodies,
+        free);
 }
 
 void create_spring(Scene *scene, double k, Body *body1, Body *body2) {
@@ -137,7 +213,8 @@ void create_spring(Scene *scene, double k, Body *body1, Body *body2) {
     List *bodies = list_init(2, NULL);
     list_add(bodies, body1);
     list_add(bodies, body2);
-    scene_add_bodies_force_creator(scene, spring_forcer, k_ptr, bodies, free);
+    scene_add_parallel_force_creator(scene, spring_forcer, k_ptr, bodies,
+        free);
 }
 
 void create_drag(Scene *scene, double gamma, Body *body) {
@@ -145,7 +222,8 @@ void create_drag(Scene *scene, double gamma, Body *body) {
     *gamma_ptr = gamma;
     List *bodies = list_init(1, NULL);
     list_add(bodies, body);
-    scene_add_bodies_force_creator(scene, drag_forcer, gamma_ptr, bodies, free);
+    scene_add_parallel_force_creator(scene, drag_forcer, gamma_ptr, bodies,
+        free);
 }
 
 void create_collision(Scene *scene, Body *body1, Body *body2,
@@ -154,9 +232,10 @@ void create_collision(Scene *scene, Body *body1, Body *body2,
     list_add(bodies, body1);
     list_add(bodies, body2);
     CollisionAux *collision_aux = malloc(sizeof(CollisionAux));
-    *collision_aux = (CollisionAux){handler, false, aux, freer};
-    scene_add_bodies_force_creator(scene, collision_forcer, collision_aux,
-        bodies, (FreeFunc)collision_aux_free);
+    *collision_aux = (CollisionAux){handler, false, VEC_ZERO, aux, freer};
+    scene_add_predicted_force_creator(scene, collision_tester,
+        collision_forcer, collision_predictor, collision_aux, bodies,
+        (FreeFunc)collision_aux_free);
 }
 
 void create_destructive_collision(Scene *scene, Body *body1, Body *body2) {
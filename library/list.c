@@ -49,7 +49,9 @@ void *list_get(List *list, size_t index) {
 
 void list_set(List *list, size_t index, void *value) {
     assert(index < list->length);
-    list->free_elem(list->arr[index]);
+    if (list->free_elem != NULL) {
+        list->free_elem(list->arr[index]);
+    }
     list->arr[index] = value;
 }
 
@@ -0,0 +1,143 @@
+#include "particles.h"
+#include "polygon.h"
+#include <assert.h>
+#include <stdlib.h>
+
+typedef struct prototype {
+    List *shape;
+    RGBColor color;
+} Prototype;
+
+typedef struct particle_system {
+    List *prototypes;
+    size_t size;
+    size_t capacity;
+    // One entry per particle in each array
+    double *x;
+    double *y;
+    double *vx;
+    double *vy;
+    double *life;           // Seconds left to live
+    size_t *prototype;
+} ParticleSystem;
+
+
+/* Frees a prototype and its shape. */
+void prototype_free(Prototype *prototype) {
+    list_free(prototype->shape);
+    free(prototype);
+}
+
+/* Reallocates every array of a particle system to hold capacity particles. */
+void particles_resize(ParticleSystem *particles, size_t capacity) {
+    particles->x = realloc(particles->x, sizeof(double) * capacity);
+    particles->y = realloc(particles->y, sizeof(double) * capacity);
+    particles->vx = realloc(particles->vx, sizeof(double) * capacity);
+    particles->vy = realloc(particles->vy, sizeof(double) * capacity);
+    particles->life = realloc(particles->life, sizeof(double) * capacity);
+    particles->prototype =
+        realloc(particles->prototype, sizeof(size_t) * capacity);
+    assert(particles->x && particles->y);
+    assert(particles->vx && particles->vy);
+    assert(particles->life && particles->prototype);
+    particles->capacity = capacity;
+}
+
+ParticleSystem *particles_init(size_t initial_size) {
+    ParticleSystem *particles = calloc(1, sizeof(ParticleSystem));
+    assert(particles);
+    particles->prototypes = list_init(1, (FreeFunc) prototype_free);
+    particles_resize(particles, initial_size > 0 ? initial_size : 1);
+    return particles;
+}
+
+void particles_free(ParticleSystem *particles) {
+    list_free(particles->prototypes);
+    free(particles->x);
+    free(particles->y);
+    free(particles->vx);
+    free(particles->vy);
+    free(particles->life);
+    free(particles->prototype);
+    free(particles);
+}
+
+size_t particles_add_prototype(ParticleSystem *particles, List *shape,
+                                RGBColor color) {
+    Prototype *prototype = malloc(sizeof(Prototype));
+    assert(prototype);
+    polygon_translate(shape, vec_negate(polygon_centroid(shape)));
+    *prototype = (Prototype) {shape, color};
+    list_add(particles->prototypes, prototype);
+    return list_size(particles->prototypes) - 1;
+}
+
+void particles_add(ParticleSystem *particles, size_t prototype,
+                    Vector position, Vector velocity, double lifetime) {
+    assert(prototype < list_size(particles->prototypes));
+    if (particles->size == particles->capacity) {
+        particles_resize(particles, particles->capacity * 2);
+    }
+    size_t i = particles->size++;
+    particles->x[i] = position.x;
+    particles->y[i] = position.y;
+    particles->vx[i] = velocity.x;
+    particles->vy[i] = velocity.y;
+    particles->life[i] = lifetime;
+    particles->prototype[i] = prototype;
+}
+
+void particles_tick(ParticleSystem *particles, double dt) {
+    size_t n = particles->size;
+    double *x = particles->x, *y = particles->y;
+    double *vx = particles->vx, *vy = particles->vy;
+    double *life = particles->life;
+
+    // Move every particle first, so this loop has no branches
+    for (size_t i = 0; i < n; i++) {
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        life[i] -= dt;
+    }
+
+    // Then replace each expired particle with the last live one
+    size_t i = 0;
+    while (i < n) {
+        if (life[i] > 0) {
+            i++;
+            continue;
+        }
+        n--;
+        x[i] = x[n];
+        y[i] = y[n];
+        vx[i] = vx[n];
+        vy[i] = vy[n];
+        life[i] = life[n];
+        particles->prototype[i] = particles->prototype[n];
+    }
+    particles->size = n;
+}
+
+size_t particles_size(ParticleSystem *particles) {
+    return particles->size;
+}
+
+Vector particles_get_position(ParticleSystem *particles, size_t index) {
+    assert(index < particles->size);
+    return (Vector) {particles->x[index], particles->y[index]};
+}
+
+size_t particles_get_prototype(ParticleSystem *particles, size_t index) {
+    assert(index < particles->size);
+    return particles->prototype[index];
+}
+
+List *particles_get_shape(ParticleSystem *particles, size_t prototype) {
+    Prototype *p = list_get(particles->prototypes, prototype);
+    return p->shape;
+}
+
+RGBColor particles_get_color(ParticleSystem *particles, size_t prototype) {
+    Prototype *p = list_get(particles->prototypes, prototype);
+    return p->color;
+}
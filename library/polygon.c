@@ -1,5 +1,7 @@
 #include "polygon.h"
+#include <assert.h>
 #include <math.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -34,9 +36,8 @@ Vector polygon_centroid(List *polygon) {
 
 void polygon_translate(List *polygon, Vector translation) {
     for(size_t i = 0; i < list_size(polygon); i++) {
-        Vector *v = malloc(sizeof(Vector));
-        *v = vec_add(v_cast(list_get(polygon, i)), translation);
-        list_set(polygon, i, v);
+        Vector *v = list_get(polygon, i);
+        *v = vec_add(*v, translation);
     }
 }
 
@@ -44,9 +45,77 @@ void polygon_rotate(List *polygon, double angle, Vector point) {
     size_t n = list_size(polygon);
     polygon_translate(polygon, vec_negate(point));
     for (size_t i = 0; i < n; i++) {
-        Vector *v = malloc(sizeof(Vector));
-        *v = vec_rotate(v_cast(list_get(polygon, i)), angle);
-        list_set(polygon, i, v);
+        Vector *v = list_get(polygon, i);
+        *v = vec_rotate(*v, angle);
     }
     polygon_translate(polygon, point);
 }
+
+/* Checks whether p is inside or on the edge of the counterclockwise triangle
+ * abc.
+ */
+bool triangle_contains(Vector a, Vector b, Vector c, Vector p) {
+    return vec_cross(vec_subtract(b, a), vec_subtract(p, a)) >= 0
+        && vec_cross(vec_subtract(c, b), vec_subtract(p, b)) >= 0
+        && vec_cross(vec_subtract(a, c), vec_subtract(p, c)) >= 0;
+}
+
+void polygon_triangulate(List *polygon, size_t *indices) {
+    size_t n = list_size(polygon);
+    assert(n >= 3);
+
+    // Vertices not clipped off yet, kept counterclockwise
+    size_t *remaining = malloc(sizeof(size_t) * n);
+    assert(remaining);
+    double signed_area = 0;
+    for (size_t i = 0; i < n; i++) {
+        signed_area += vec_cross(v_cast(list_get(polygon, i)),
+                                v_cast(list_get(polygon, (i + 1) % n)));
+    }
+    for (size_t i = 0; i < n; i++) {
+        remaining[i] = signed_area >= 0 ? i : n - 1 - i;
+    }
+
+    size_t m = n;
+    size_t n_indices = 0;
+    while (m > 3) {
+        size_t ear = 0;     // Clip the first vertex if no ear is found
+        for (size_t i = 0; i < m; i++) {
+            Vector a = v_cast(list_get(polygon, remaining[(i + m - 1) % m]));
+            Vector b = v_cast(list_get(polygon, remaining[i]));
+            Vector c = v_cast(list_get(polygon, remaining[(i + 1) % m]));
+            // An ear is convex and has no other vertex inside it; a vertex
+            // on a straight edge is clipped off as an empty triangle
+            double turn = vec_cross(vec_subtract(b, a), vec_subtract(c, b));
+            if (turn < 0) {
+                continue;
+            }
+            bool is_ear = true;
+            if (turn == 0) {
+                ear = i;
+                break;
+            }
+            for (size_t j = 0; j < m && is_ear; j++) {
+                if (j == i || j == (i + m - 1) % m || j == (i + 1) % m) {
+                    continue;
+                }
+                Vector p = v_cast(list_get(polygon, remaining[j]));
+                is_ear = !triangle_contains(a, b, c, p);
+            }
+            if (is_ear) {
+                ear = i;
+                break;
+            }
+        }
+        indices[n_indices++] = remaining[(ear + m - 1) % m];
+        indices[n_indices++] = remaining[ear];
+        indices[n_indices++] = remaining[(ear + 1) % m];
+        memmove(&remaining[ear], &remaining[ear + 1],
+                sizeof(size_t) * (m - ear - 1));
+        m--;
+    }
+    indices[n_indices++] = remaining[0];
+    indices[n_indices++] = remaining[1];
+    indices[n_indices++] = remaining[2];
+    free(remaining);
+}
@@ -0,0 +1,107 @@
+#include "raster.h"
+#include <math.h>
+#include <stdint.h>
+
+/**
+ * Four pixels written by one SIMD store.
+ */
+typedef uint32_t Pixel4 __attribute__((vector_size(4 * sizeof(uint32_t))));
+
+
+/**
+ * Finds the first pixel whose center is at or past a coordinate,
+ * clamped to [0, limit].
+ */
+int first_pixel(float coordinate, int limit) {
+    float pixel = ceilf(coordinate - 0.5f);
+    if (!(pixel > 0)) {
+        return 0;
+    }
+    return pixel < limit ? (int) pixel : limit;
+}
+
+/**
+ * Fills the pixels [x0, x1) of a row. Single pixels are written up to a
+ * 16-byte boundary, then four at a time with aligned stores.
+ */
+void fill_span(uint32_t *row, int x0, int x1, uint32_t color) {
+    Pixel4 colors = {color, color, color, color};
+    int x = x0;
+    for (; x < x1 && (uintptr_t) &row[x] % sizeof(Pixel4) != 0; x++) {
+        row[x] = color;
+    }
+    for (; x + 4 <= x1; x += 4) {
+        *(Pixel4 *) &row[x] = colors;
+    }
+    for (; x < x1; x++) {
+        row[x] = color;
+    }
+}
+
+/**
+ * Fills the pixels of a row whose centers are between two x coordinates.
+ */
+void fill_between(Framebuffer *buffer, int y, float left, float right,
+                    uint32_t color) {
+    int x0 = first_pixel(left, buffer->width),
+        x1 = first_pixel(right, buffer->width);
+    if (x0 < x1) {
+        fill_span(&buffer->pixels[y * buffer->pitch], x0, x1, color);
+    }
+}
+
+void raster_clear(Framebuffer *buffer, uint32_t color) {
+    for (int y = 0; y < buffer->height; y++) {
+        fill_span(&buffer->pixels[y * buffer->pitch], 0, buffer->width,
+            color);
+    }
+}
+
+void raster_fill_rect(Framebuffer *buffer, float x0, float y0,
+                        float x1, float y1, uint32_t color) {
+    float left = fminf(x0, x1), right = fmaxf(x0, x1);
+    int top = first_pixel(fminf(y0, y1), buffer->height),
+        bottom = first_pixel(fmaxf(y0, y1), buffer->height);
+    for (int y = top; y < bottom; y++) {
+        fill_between(buffer, y, left, right, color);
+    }
+}
+
+void raster_fill_convex(Framebuffer *buffer, const float *xy, size_t n,
+                        uint32_t color) {
+    float min_y = INFINITY, max_y = -INFINITY;
+    for (size_t i = 0; i < n; i++) {
+        min_y = fminf(min_y, xy[2 * i + 1]);
+        max_y = fmaxf(max_y, xy[2 * i + 1]);
+    }
+    int top = first_pixel(min_y, buffer->height),
+        bottom = first_pixel(max_y, buffer->height);
+    for (int y = top; y < bottom; y++) {
+        // Where the row's centers cross the polygon's edges
+        float row_y = y + 0.5f;
+        float left = INFINITY, right = -INFINITY;
+        for (size_t i = 0, j = n - 1; i < n; j = i++) {
+            float ax = xy[2 * j], ay = xy[2 * j + 1],
+                  bx = xy[2 * i], by = xy[2 * i + 1];
+            if ((ay <= row_y) != (by <= row_y)) {
+                float x = ax + (row_y - ay) * (bx - ax) / (by - ay);
+                left = fminf(left, x);
+                right = fmaxf(right, x);
+            }
+        }
+        if (left < right) {
+            fill_between(buffer, y, left, right, color);
+        }
+    }
+}
+
+void raster_fill_circle(Framebuffer *buffer, float x, float y, float radius,
+                        uint32_t color) {
+    int top = first_pixel(y - radius, buffer->height),
+        bottom = first_pixel(y + radius, buffer->height);
+    for (int row = top; row < bottom; row++) {
+        float dy = row + 0.5f - y;
+        float half_width = sqrtf(fmaxf(radius * radius - dy * dy, 0));
+        fill_between(buffer, row, x - half_width, x + half_width, color);
+    }
+}
@@ -1,14 +1,68 @@
 #include "scene.h"
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 
 
 #define BODIES 25       // # bodies to initialize scene with
+#define MIN_FORCES_PER_THREAD 64    // Smaller batches are evaluated serially
+#define EVENTS 64       // # events to initialize kinetic event queue with
+/* Time past a predicted event at which its force is evaluated, so the
+ * bodies are strictly overlapping or strictly apart. Events closer together
+ * than half of this are evaluated as one batch.
+ */
+#define EVENT_EPSILON 1e-7
 
+typedef struct force_pool ForcePool;
+typedef struct kinetic_state KineticState;
+
+/* A thread evaluating a range of a batch of force creators. */
+typedef struct worker {
+    ForcePool *pool;
+    pthread_t thread;
+    BodyAccumulator *acc;
+    List *contacts;     // Tested force creators in range that must act
+    size_t start;       // Range of pool->batch to evaluate
+    size_t end;
+} Worker;
+
+/* Threads that evaluate batches of force creators. Worker 0 is the thread
+ * calling scene_tick(); the others wait for a new generation of work.
+ */
+typedef struct force_pool {
+    size_t n_threads;
+    Worker *workers;
+    List *batch;        // Batch being evaluated; owned by the scene
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    size_t generation;  // Incremented each time a batch is handed out
+    size_t pending;     // # workers still evaluating the current batch
+    bool shutdown;
+} ForcePool;
 
 typedef struct scene {
     List *bodies;
     List *forces;
+    size_t n_types;
+    BodyTypeFunc get_type;
+    List **typed_bodies;    // One list of bodies per type; NULL if untyped
+    List *batch;        // Parallel and tested forces waiting to be evaluated
+    List *contacts;     // Tested forces that must act, when run serially
+    ForcePool *pool;    // NULL if forces are evaluated serially
+    size_t next_order;  // Order to give the next force added
+    double max_step_fraction;   // Of its radius a body may move per substep
+    size_t max_substeps;
+    size_t bodies_version;  // Changed when bodies are added or removed
+    Body **fast_bodies; // Bodies that need substeps this tick, by address
+    Vector *fast_forces;    // Force on each fast body at the first substep
+    size_t n_fast;
+    size_t max_fast;    // Capacity of fast_bodies and fast_forces
+    List *substep_forces;   // Tested forces acting on fast bodies
+    KineticState *kinetic;  // NULL unless in kinetic mode
 } Scene;
 
 typedef struct force {
@@ -16,8 +70,52 @@ typedef struct force {
     void *aux;
     List *bodies;
     FreeFunc freer;     // Frees aux
+    bool parallel;      // Whether forcer may run concurrently with others
+    ForceTester tester; // If non-NULL, decides whether forcer must act
+    ForcePredictor predictor;   // If non-NULL, predicts when tester changes
+    size_t order;       // Position among all forces ever added to the scene
+    size_t stamp;       // Incremented when queued events become stale
 } Force;
 
+/* A predicted change in the outcome of a force's tester. */
+typedef struct event {
+    double time;        // Kinetic clock time at which to evaluate the force
+    Force *force;
+    size_t stamp;       // The force's stamp when predicted; stale if changed
+} Event;
+
+/* A predicted force acting on a body, for finding forces to predict again
+ * when the body's motion changes.
+ */
+typedef struct body_force {
+    Body *body;
+    Force *force;
+} BodyForce;
+
+/* A body acted on by predicted forces. */
+typedef struct body_entry {
+    Body *body;
+    size_t version;     // Motion version when its forces were last predicted
+    size_t start;       // Range of its forces in KineticState.body_forces
+    size_t end;
+} BodyEntry;
+
+/* State of a scene in kinetic mode. */
+typedef struct kinetic_state {
+    double time;        // Kinetic clock, advanced by scene_tick()
+    Event *events;      // Binary min-heap ordered by time, then force order
+    size_t n_events;
+    size_t max_events;
+    size_t n_predicted; // Forces in scene->forces before this are predicted
+    bool index_stale;   // Whether forces were added or removed since indexing
+    BodyForce *body_forces;     // Predicted forces sorted by body
+    size_t n_body_forces;
+    BodyEntry *entries;         // Bodies in body_forces, sorted by body
+    size_t n_entries;
+    size_t max_body_forces;     // Capacity of body_forces and entries
+    List *fired;        // Forces evaluated by the current event batch
+} KineticState;
+
 
 void force_free(Force *f) {
     f->freer(f->aux);
@@ -25,21 +123,591 @@ void force_free(Force *f) {
     free(f);
 }
 
+/* Empties a list that doesn't own its elements. */
+void clear_list(List *list) {
+    while (list_size(list) > 0) {
+        list_remove(list, list_size(list) - 1);
+    }
+}
+
+/* Returns whether none of the bodies a force acts on are marked for removal.
+ */
+bool force_bodies_exist(Force *f) {
+    for (size_t j = 0; j < list_size(f->bodies); j++) {
+        Body *b = (Body *)list_get(f->bodies, j);
+        if (body_is_removed(b)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Evaluates a batched force. Parallel forcers are run directly; tested forces
+ * are only tested, and are added to contacts if their forcer must act.
+ */
+void force_evaluate(Force *f, List *contacts) {
+    if (f->tester) {
+        if (f->tester(f->bodies, f->aux)) {
+            list_add(contacts, f);
+        }
+    }
+    else {
+        f->forcer(f->bodies, f->aux);
+    }
+}
+
+/* Runs the forcers of tested forces that must act, in order, skipping any
+ * whose bodies were removed by an earlier forcer. Empties contacts.
+ */
+void resolve_contacts(List *contacts) {
+    for (size_t i = 0; i < list_size(contacts); i++) {
+        Force *f = list_get(contacts, i);
+        if (force_bodies_exist(f)) {
+            f->forcer(f->bodies, f->aux);
+        }
+    }
+    clear_list(contacts);
+}
+
+/* Evaluates a worker's range of the current batch into its accumulator and
+ * contact buffer.
+ */
+void worker_run(Worker *w) {
+    body_accumulator_begin(w->acc);
+    for (size_t i = w->start; i < w->end; i++) {
+        force_evaluate(list_get(w->pool->batch, i), w->contacts);
+    }
+    body_accumulator_end();
+}
+
+/* Main loop of the pool's background threads. */
+void *worker_loop(void *arg) {
+    Worker *w = arg;
+    ForcePool *pool = w->pool;
+    size_t seen = 0;
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        worker_run(w);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->pending--;
+        if (pool->pending == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+ForcePool *force_pool_init(size_t n_threads) {
+    assert(n_threads > 1);
+    ForcePool *pool = malloc(sizeof(ForcePool));
+    assert(pool);
+    pool->n_threads = n_threads;
+    pool->workers = malloc(sizeof(Worker) * n_threads);
+    assert(pool->workers);
+    pool->batch = NULL;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+    pool->generation = 0;
+    pool->pending = 0;
+    pool->shutdown = false;
+
+    for (size_t i = 0; i < n_threads; i++) {
+        Worker *w = &pool->workers[i];
+        *w = (Worker) {
+            .pool = pool,
+            .acc = body_accumulator_init(),
+            .contacts = list_init(BODIES, NULL)
+        };
+        if (i > 0) {
+            int err = pthread_create(&w->thread, NULL, worker_loop, w);
+            assert(err == 0);
+        }
+    }
+    return pool;
+}
+
+void force_pool_free(ForcePool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->n_threads; i++) {
+        if (i > 0) {
+            pthread_join(pool->workers[i].thread, NULL);
+        }
+        body_accumulator_free(pool->workers[i].acc);
+        list_free(pool->workers[i].contacts);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->workers);
+    free(pool);
+}
+
+/* Splits a batch of forces into contiguous ranges across the pool's
+ * workers and waits for them to finish, then applies each worker's
+ * accumulator and runs its contacts in worker order. Since the ranges are in
+ * scene order, this matches evaluating the batch on a single thread.
+ */
+void force_pool_run(ForcePool *pool, List *batch, size_t n_workers) {
+    size_t n = list_size(batch);
+    pthread_mutex_lock(&pool->lock);
+    pool->batch = batch;
+    for (size_t i = 0; i < pool->n_threads; i++) {
+        Worker *w = &pool->workers[i];
+        // Idle workers get an empty range
+        w->start = i < n_workers ? n * i / n_workers : n;
+        w->end = i < n_workers ? n * (i + 1) / n_workers : n;
+    }
+    pool->pending = pool->n_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    worker_run(&pool->workers[0]);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pool->batch = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < n_workers; i++) {
+        body_accumulator_apply(pool->workers[i].acc);
+    }
+    for (size_t i = 0; i < n_workers; i++) {
+        resolve_contacts(pool->workers[i].contacts);
+    }
+}
+
+/* Evaluates the scene's batch of parallel and tested forces: every force is
+ * evaluated (tested forces are only tested), then the forcers of tested
+ * forces that must act are run in scene order. The batch is split across the
+ * scene's threads when it is large enough; either way the outcome is the
+ * same. Empties the batch.
+ */
+void run_batch(Scene *scene) {
+    size_t n = list_size(scene->batch);
+    if (n == 0) {
+        return;
+    }
+
+    size_t n_workers = 1;
+    if (scene->pool) {
+        n_workers = n / MIN_FORCES_PER_THREAD;
+        if (n_workers > scene->pool->n_threads) {
+            n_workers = scene->pool->n_threads;
+        }
+    }
+    if (n_workers <= 1) {
+        for (size_t i = 0; i < n; i++) {
+            force_evaluate(list_get(scene->batch, i), scene->contacts);
+        }
+        resolve_contacts(scene->contacts);
+    }
+    else {
+        force_pool_run(scene->pool, scene->batch, n_workers);
+    }
+    clear_list(scene->batch);
+}
+
+/* Returns whether event e1 should be processed before event e2. */
+bool event_before(Event e1, Event e2) {
+    if (e1.time != e2.time) {
+        return e1.time < e2.time;
+    }
+    return e1.force->order < e2.force->order;
+}
+
+/* Adds an event to the kinetic event heap. */
+void event_push(KineticState *k, Event e) {
+    if (k->n_events == k->max_events) {
+        k->max_events *= 2;
+        k->events = realloc(k->events, k->max_events * sizeof(Event));
+        assert(k->events);
+    }
+    size_t i = k->n_events++;
+    while (i > 0 && event_before(e, k->events[(i - 1) / 2])) {
+        k->events[i] = k->events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    k->events[i] = e;
+}
+
+/* Moves the event at index i down the heap until the heap is ordered. */
+void event_sift_down(KineticState *k, size_t i) {
+    Event e = k->events[i];
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= k->n_events) {
+            break;
+        }
+        if (child + 1 < k->n_events
+            && event_before(k->events[child + 1], k->events[child])) {
+            child++;
+        }
+        if (!event_before(k->events[child], e)) {
+            break;
+        }
+        k->events[i] = k->events[child];
+        i = child;
+    }
+    k->events[i] = e;
+}
+
+/* Removes and returns the earliest event. Asserts the heap is not empty. */
+Event event_pop(KineticState *k) {
+    assert(k->n_events > 0);
+    Event top = k->events[0];
+    k->n_events--;
+    if (k->n_events > 0) {
+        k->events[0] = k->events[k->n_events];
+        event_sift_down(k, 0);
+    }
+    return top;
+}
+
+/* Discards stale events from the top of the heap, and returns whether any
+ * events are left.
+ */
+bool events_pending(KineticState *k) {
+    while (k->n_events > 0) {
+        Event top = k->events[0];
+        if (top.stamp == top.force->stamp && force_bodies_exist(top.force)) {
+            return true;
+        }
+        event_pop(k);
+    }
+    return false;
+}
+
+/* Discards every event of forces that are about to be removed, since the
+ * heap must not outlive them.
+ */
+void drop_removed_events(KineticState *k) {
+    size_t kept = 0;
+    for (size_t i = 0; i < k->n_events; i++) {
+        if (force_bodies_exist(k->events[i].force)) {
+            k->events[kept++] = k->events[i];
+        }
+    }
+    k->n_events = kept;
+    for (size_t i = kept / 2; i-- > 0;) {
+        event_sift_down(k, i);
+    }
+}
+
+/* Invalidates a force's queued events and queues its next predicted event,
+ * if it has one.
+ */
+void predict_force(KineticState *k, Force *f) {
+    f->stamp++;
+    if (!force_bodies_exist(f)) {
+        return;
+    }
+    double t = f->predictor(f->bodies, f->aux);
+    if (t < INFINITY) {
+        assert(t >= 0);
+        event_push(k, (Event) {k->time + t + EVENT_EPSILON, f, f->stamp});
+    }
+}
+
+int compare_body_forces(const void *p1, const void *p2) {
+    uintptr_t b1 = (uintptr_t)((BodyForce *)p1)->body;
+    uintptr_t b2 = (uintptr_t)((BodyForce *)p2)->body;
+    size_t o1 = ((BodyForce *)p1)->force->order;
+    size_t o2 = ((BodyForce *)p2)->force->order;
+    if (b1 != b2) {
+        return b1 < b2 ? -1 : 1;
+    }
+    return o1 < o2 ? -1 : (o1 > o2);
+}
+
+/* Rebuilds the index from bodies to the predicted forces acting on them.
+ * Bodies' motion versions are taken as already predicted.
+ */
+void index_body_forces(Scene *scene) {
+    KineticState *k = scene->kinetic;
+    size_t n = 0;
+    for (size_t i = 0; i < list_size(scene->forces); i++) {
+        Force *f = list_get(scene->forces, i);
+        if (f->predictor) {
+            n += list_size(f->bodies);
+        }
+    }
+    // Reuse the buffers unless they are too small
+    if (n > k->max_body_forces) {
+        k->max_body_forces = 2 * n;
+        k->body_forces = realloc(k->body_forces,
+            sizeof(BodyForce) * k->max_body_forces);
+        k->entries = realloc(k->entries,
+            sizeof(BodyEntry) * k->max_body_forces);
+        assert(k->body_forces && k->entries);
+    }
+
+    k->n_body_forces = 0;
+    for (size_t i = 0; i < list_size(scene->forces); i++) {
+        Force *f = list_get(scene->forces, i);
+        if (!f->predictor) {
+            continue;
+        }
+        for (size_t j = 0; j < list_size(f->bodies); j++) {
+            k->body_forces[k->n_body_forces++] =
+                (BodyForce) {list_get(f->bodies, j), f};
+        }
+    }
+    qsort(k->body_forces, n, sizeof(BodyForce), compare_body_forces);
+
+    k->n_entries = 0;
+    for (size_t i = 0; i < n; i++) {
+        Body *b = k->body_forces[i].body;
+        if (i == 0 || k->body_forces[i - 1].body != b) {
+            k->entries[k->n_entries++] =
+                (BodyEntry) {b, body_get_motion_version(b), i, i};
+        }
+        k->entries[k->n_entries - 1].end = i + 1;
+    }
+    k->index_stale = false;
+}
+
+/* Brings the kinetic event queue up to date: predicts again the forces on
+ * every body whose motion changed since it was last predicted, and predicts
+ * any forces added since the last update.
+ */
+void update_predictions(Scene *scene) {
+    KineticState *k = scene->kinetic;
+    for (size_t i = 0; i < k->n_entries; i++) {
+        BodyEntry *entry = &k->entries[i];
+        if (body_is_removed(entry->body)) {
+            continue;
+        }
+        size_t version = body_get_motion_version(entry->body);
+        if (version == entry->version) {
+            continue;
+        }
+        entry->version = version;
+        for (size_t j = entry->start; j < entry->end; j++) {
+            predict_force(k, k->body_forces[j].force);
+        }
+    }
+
+    size_t n_forces = list_size(scene->forces);
+    if (k->n_predicted == n_forces && !k->index_stale) {
+        return;
+    }
+    index_body_forces(scene);
+    for (size_t i = k->n_predicted; i < n_forces; i++) {
+        Force *f = list_get(scene->forces, i);
+        if (f->predictor) {
+            predict_force(k, f);
+        }
+    }
+    k->n_predicted = n_forces;
+}
+
+/* Moves every body along its current velocity up to the given kinetic time,
+ * then applies any impulses added since the last call.
+ */
+void advance_bodies(Scene *scene, double time) {
+    double dt = time - scene->kinetic->time;
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *b = scene_get_body(scene, i);
+        if (!body_is_removed(b)) {
+            body_tick(b, dt);
+        }
+    }
+    scene->kinetic->time = time;
+}
+
+/* Advances a kinetic scene by dt, from event to event. At each event, the
+ * events within EVENT_EPSILON / 2 of it are evaluated as one batch, in force
+ * order, as in a fixed-step tick; afterwards every force whose bodies' motion
+ * changed is predicted again.
+ */
+void kinetic_advance(Scene *scene, double dt) {
+    KineticState *k = scene->kinetic;
+    double end = k->time + dt;
+    // Impulses from forces without predictors apply at the start of the tick
+    advance_bodies(scene, k->time);
+    update_predictions(scene);
+
+    while (events_pending(k) && k->events[0].time <= end) {
+        double time = k->events[0].time;
+        advance_bodies(scene, time);
+        while (events_pending(k)
+                && k->events[0].time <= time + EVENT_EPSILON / 2) {
+            list_add(k->fired, event_pop(k).force);
+        }
+
+        // Evaluate the batch in force order, regardless of event times
+        for (size_t i = 1; i < list_size(k->fired); i++) {
+            Force *f = list_get(k->fired, i);
+            size_t j = i;
+            while (j > 0 && ((Force *)list_get(k->fired, j - 1))->order
+                                > f->order) {
+                list_set(k->fired, j, list_get(k->fired, j - 1));
+                j--;
+            }
+            list_set(k->fired, j, f);
+        }
+        for (size_t i = 0; i < list_size(k->fired); i++) {
+            list_add(scene->batch, list_get(k->fired, i));
+        }
+        run_batch(scene);
+
+        // Apply impulses from the batch, then predict what they changed
+        advance_bodies(scene, time);
+        for (size_t i = 0; i < list_size(k->fired); i++) {
+            predict_force(k, list_get(k->fired, i));
+        }
+        clear_list(k->fired);
+        update_predictions(scene);
+    }
+    advance_bodies(scene, end);
+}
+
+KineticState *kinetic_state_init(void) {
+    KineticState *k = malloc(sizeof(KineticState));
+    assert(k);
+    k->time = 0.0;
+    k->events = malloc(sizeof(Event) * EVENTS);
+    assert(k->events);
+    k->n_events = 0;
+    k->max_events = EVENTS;
+    k->n_predicted = 0;
+    k->index_stale = true;
+    k->body_forces = NULL;
+    k->n_body_forces = 0;
+    k->entries = NULL;
+    k->n_entries = 0;
+    k->max_body_forces = 0;
+    k->fired = list_init(BODIES, NULL);
+    return k;
+}
+
+void kinetic_state_free(KineticState *k) {
+    free(k->events);
+    free(k->body_forces);
+    free(k->entries);
+    list_free(k->fired);
+    free(k);
+}
+
 Scene *scene_init() {
+    return scene_init_with_types(0, NULL);
+}
+
+Scene *scene_init_with_types(size_t n_types, BodyTypeFunc get_type) {
+    assert(n_types == 0 || get_type != NULL);
     Scene *s = malloc(sizeof(Scene));
+    assert(s);
     List *bodies = list_init(BODIES, (FreeFunc)body_free);
-    List *forces = list_init(BODIES, (FreeFunc)force_free);
+    List *forces = list_init(BODIES, NULL);    // Compacted in scene_tick()
     s->bodies = bodies;
     s->forces = forces;
+    s->n_types = n_types;
+    s->get_type = get_type;
+    s->typed_bodies = NULL;
+    s->batch = list_init(BODIES, NULL);
+    s->contacts = list_init(BODIES, NULL);
+    s->pool = NULL;
+    s->next_order = 0;
+    s->max_step_fraction = 1.0;
+    s->max_substeps = 1;
+    s->bodies_version = 0;
+    s->fast_bodies = NULL;
+    s->fast_forces = NULL;
+    s->n_fast = 0;
+    s->max_fast = 0;
+    s->substep_forces = list_init(BODIES, NULL);
+    s->kinetic = NULL;
+    if (n_types > 0) {
+        s->typed_bodies = malloc(sizeof(List *) * n_types);
+        assert(s->typed_bodies);
+        for (size_t i = 0; i < n_types; i++) {
+            s->typed_bodies[i] = list_init(BODIES, NULL);
+        }
+    }
     return s;
 }
 
 void scene_free(Scene *scene) {
+    if (scene->pool) {
+        force_pool_free(scene->pool);
+    }
+    if (scene->kinetic) {
+        kinetic_state_free(scene->kinetic);
+    }
+    for (size_t i = 0; i < scene->n_types; i++) {
+        list_free(scene->typed_bodies[i]);
+    }
+    free(scene->typed_bodies);
+    list_free(scene->batch);
+    list_free(scene->contacts);
+    free(scene->fast_bodies);
+    free(scene->fast_forces);
+    list_free(scene->substep_forces);
     list_free(scene->bodies);
+    for (size_t i = 0; i < list_size(scene->forces); i++) {
+        force_free(list_get(scene->forces, i));
+    }
     list_free(scene->forces);
     free(scene);
 }
 
+/* Returns the list of bodies of the given type. */
+List *get_typed_bodies(Scene *scene, size_t type) {
+    assert(scene->typed_bodies != NULL);
+    assert(type < scene->n_types);
+    return scene->typed_bodies[type];
+}
+
+/* Removes the given body from a list of bodies that doesn't own them. */
+void remove_from_typed_bodies(List *bodies, Body *body) {
+    for (size_t i = 0; i < list_size(bodies); i++) {
+        if (list_get(bodies, i) == body) {
+            list_remove(bodies, i);
+            return;
+        }
+    }
+}
+
+/* Drops bodies marked for removal from every type list in a single pass per
+ * list, preserving the order of the remaining bodies.
+ */
+void purge_typed_bodies(Scene *scene) {
+    for (size_t t = 0; t < scene->n_types; t++) {
+        List *bodies = scene->typed_bodies[t];
+        size_t n = list_size(bodies);
+        size_t kept = 0;
+        for (size_t i = 0; i < n; i++) {
+            Body *b = list_get(bodies, i);
+            if (!body_is_removed(b)) {
+                list_set(bodies, kept, b);
+                kept++;
+            }
+        }
+        while (list_size(bodies) > kept) {
+            list_remove(bodies, list_size(bodies) - 1);
+        }
+    }
+}
+
 size_t scene_bodies(Scene *scene) {
     return list_size(scene->bodies);
 }
@@ -48,12 +716,42 @@ Body *scene_get_body(Scene *scene, size_t index) {
     return ((Body *)list_get(scene->bodies, index));
 }
 
+size_t scene_get_bodies_version(Scene *scene) {
+    return scene->bodies_version;
+}
+
+size_t scene_bodies_of_type(Scene *scene, size_t type) {
+    return list_size(get_typed_bodies(scene, type));
+}
+
+Body *scene_get_body_of_type(Scene *scene, size_t type, size_t index) {
+    return ((Body *)list_get(get_typed_bodies(scene, type), index));
+}
+
+void scene_retype_body(Scene *scene, Body *body, size_t old_type) {
+    size_t new_type = scene->get_type(body);
+    if (new_type == old_type) {
+        return;
+    }
+    remove_from_typed_bodies(get_typed_bodies(scene, old_type), body);
+    list_add(get_typed_bodies(scene, new_type), body);
+}
+
 void scene_add_body(Scene *scene, Body *body) {
     list_add(scene->bodies, body);
+    scene->bodies_version++;
+    if (scene->typed_bodies != NULL) {
+        list_add(get_typed_bodies(scene, scene->get_type(body)), body);
+    }
 }
 
 void scene_remove_body(Scene *scene, size_t index) {
     Body *b = list_remove(scene->bodies, index);
+    scene->bodies_version++;
+    if (scene->typed_bodies != NULL) {
+        remove_from_typed_bodies(get_typed_bodies(scene, scene->get_type(b)),
+            b);
+    }
     body_free(b);
 }
 
@@ -62,63 +760,306 @@ void scene_add_force_creator(Scene *scene, ForceCreator forcer, void *aux,
     scene_add_bodies_force_creator(scene, forcer, aux, NULL, freer);
 }
 
-void scene_add_bodies_force_creator(Scene *scene, ForceCreator forcer,
-                                    void *aux, List *bodies, FreeFunc freer) {
+/* Adds a force of any kind to the scene. */
+void add_force(Scene *scene, ForceCreator forcer, void *aux, List *bodies,
+                FreeFunc freer, bool parallel, ForceTester tester,
+                ForcePredictor predictor) {
     Force *f = malloc(sizeof(Force));
-    *f = (Force){forcer, aux, bodies, freer};
+    assert(f);
+    *f = (Force){forcer, aux, bodies, freer, parallel, tester, predictor,
+                    scene->next_order++, 0};
     list_add(scene->forces, f);
 }
 
-void scene_tick(Scene *scene, double dt) {
-    // Apply all forces
-    for (size_t i = 0; i < list_size(scene->forces); i++) {
-        Force *f = (Force *)list_get(scene->forces, i);
+void scene_add_bodies_force_creator(Scene *scene, ForceCreator forcer,
+                                    void *aux, List *bodies, FreeFunc freer) {
+    add_force(scene, forcer, aux, bodies, freer, false, NULL, NULL);
+}
+
+void scene_add_parallel_force_creator(Scene *scene, ForceCreator forcer,
+                                    void *aux, List *bodies, FreeFunc freer) {
+    add_force(scene, forcer, aux, bodies, freer, true, NULL, NULL);
+}
+
+void scene_add_tested_force_creator(Scene *scene, ForceTester tester,
+                                    ForceCreator forcer, void *aux,
+                                    List *bodies, FreeFunc freer) {
+    assert(tester != NULL);
+    add_force(scene, forcer, aux, bodies, freer, false, tester, NULL);
+}
+
+void scene_add_predicted_force_creator(Scene *scene, ForceTester tester,
+                                    ForceCreator forcer,
+                                    ForcePredictor predictor, void *aux,
+                                    List *bodies, FreeFunc freer) {
+    assert(tester != NULL);
+    assert(predictor != NULL);
+    add_force(scene, forcer, aux, bodies, freer, false, tester, predictor);
+}
+
+void scene_set_threads(Scene *scene, size_t n_threads) {
+    assert(n_threads > 0);
+    if (scene->pool) {
+        force_pool_free(scene->pool);
+        scene->pool = NULL;
+    }
+    if (n_threads > 1) {
+        scene->pool = force_pool_init(n_threads);
+    }
+}
+
+void scene_set_kinetic(Scene *scene, bool kinetic) {
+    if (scene->kinetic && !kinetic) {
+        kinetic_state_free(scene->kinetic);
+        scene->kinetic = NULL;
+    }
+    else if (!scene->kinetic && kinetic) {
+        scene->kinetic = kinetic_state_init();
+    }
+}
+
+double scene_next_event(Scene *scene) {
+    assert(scene->kinetic);
+    update_predictions(scene);
+    if (!events_pending(scene->kinetic)) {
+        return INFINITY;
+    }
+    double t = scene->kinetic->events[0].time - scene->kinetic->time;
+    return t > 0 ? t : 0;
+}
+
+/* Applies all forces once, except predicted forces in kinetic mode.
+ * Runs of parallel and tested forces are batched; anything else must first
+ * wait for the batch so forces are still applied in scene order. Forcers may
+ * add forces, which are applied this tick too.
+ */
+void apply_forces(Scene *scene) {
+    size_t next = 0;
+    while (next < list_size(scene->forces) || list_size(scene->batch) > 0) {
+        if (next == list_size(scene->forces)) {
+            run_batch(scene);
+            continue;
+        }
+        Force *f = (Force *)list_get(scene->forces, next);
+        next++;
 
         // Only apply force if all related bodies exist
-        bool bodies_exist = true;
-        for (size_t j = 0; j < list_size(f->bodies); j++) {
-            Body *b = (Body *)list_get(f->bodies, j);
-            if (body_is_removed(b)) {
-                bodies_exist = false;
-                break;
-            }
+        if (!force_bodies_exist(f) || (scene->kinetic && f->predictor)) {
+            continue;
         }
-        if (bodies_exist) {
+        if (f->parallel || f->tester) {
+            list_add(scene->batch, f);
+        }
+        else {
+            run_batch(scene);
             f->forcer(f->bodies, f->aux);
         }
     }
+}
 
-    // Remove force creators acting on bodies marked for removal
-    size_t i = 0;
-    while (i < list_size(scene->forces)) {
-        Force *f = list_get(scene->forces, i);
-        bool force_removed = false;
-        for (size_t j = 0; j < list_size(f->bodies); j++) {
-            Body *b = (Body *)list_get(f->bodies, j);
-            if (body_is_removed(b)) {
-                force_removed = true;
-                break;
-            }
+void scene_set_substeps(Scene *scene, double max_fraction,
+                        size_t max_substeps) {
+    assert(max_fraction > 0);
+    assert(max_substeps > 0);
+    scene->max_step_fraction = max_fraction;
+    scene->max_substeps = max_substeps;
+}
+
+/* Orders bodies by address, for looking them up with bsearch(). */
+int compare_bodies(const void *p1, const void *p2) {
+    uintptr_t b1 = (uintptr_t)*(Body **)p1;
+    uintptr_t b2 = (uintptr_t)*(Body **)p2;
+    return b1 < b2 ? -1 : (b1 > b2);
+}
+
+/* Returns the number of substeps to split a tick of length dt into, so the
+ * fastest body relative to its radius moves at most max_step_fraction of its
+ * radius per substep. Collects the bodies that would move farther than that
+ * in one step into fast_bodies, sorted by address.
+ */
+size_t count_substeps(Scene *scene, double dt) {
+    scene->n_fast = 0;
+    if (scene->max_substeps == 1) {
+        return 1;
+    }
+    size_t n_bodies = scene_bodies(scene);
+    if (scene->max_fast < n_bodies) {
+        scene->max_fast = n_bodies;
+        scene->fast_bodies = realloc(scene->fast_bodies,
+            sizeof(Body *) * n_bodies);
+        scene->fast_forces = realloc(scene->fast_forces,
+            sizeof(Vector) * n_bodies);
+        assert(scene->fast_bodies);
+        assert(scene->fast_forces);
+    }
+    double max_steps = 1.0;
+    for (size_t i = 0; i < n_bodies; i++) {
+        Body *b = scene_get_body(scene, i);
+        double radius = body_get_radius(b);
+        if (radius == 0.0 || body_is_stationary(b) || body_is_removed(b)) {
+            continue;
         }
-        if (force_removed) {
-            list_remove(scene->forces, i);
-            force_free(f);
+        double distance = vec_norm(body_get_velocity(b)) * dt;
+        double steps = distance / (scene->max_step_fraction * radius);
+        if (steps <= 1.0) {
+            continue;
+        }
+        scene->fast_bodies[scene->n_fast++] = b;
+        if (steps > max_steps) {
+            max_steps = steps;
+        }
+    }
+    qsort(scene->fast_bodies, scene->n_fast, sizeof(Body *), compare_bodies);
+    if (max_steps >= scene->max_substeps) {
+        return scene->max_substeps;
+    }
+    return (size_t)ceil(max_steps);
+}
+
+/* Returns whether a body was found to need substeps this tick. */
+bool is_fast(Scene *scene, Body *body) {
+    return bsearch(&body, scene->fast_bodies, scene->n_fast, sizeof(Body *),
+        compare_bodies) != NULL;
+}
+
+/* Removes the bodies marked for removal and the forces acting on them. */
+void remove_bodies(Scene *scene) {
+    // Remove force creators acting on bodies marked for removal, in one pass
+    size_t n_forces = list_size(scene->forces);
+    size_t kept = 0;
+    for (size_t i = 0; i < n_forces; i++) {
+        Force *f = list_get(scene->forces, i);
+        if (force_bodies_exist(f)) {
+            list_set(scene->forces, kept, f);
+            kept++;
         }
         else {
-            i++;
+            force_free(f);
         }
     }
+    while (list_size(scene->forces) > kept) {
+        list_remove(scene->forces, list_size(scene->forces) - 1);
+    }
+    if (scene->kinetic && kept < n_forces) {
+        index_body_forces(scene);
+        scene->kinetic->n_predicted = kept;
+    }
+
+    // Forget removed bodies in the type index before they are freed
+    purge_typed_bodies(scene);
 
-    // Remove bodies marked for removal and tick each body
-    i = 0;
+    size_t i = 0;
     while (i < scene_bodies(scene)) {
         Body *b = scene_get_body(scene, i);
         if (body_is_removed(b)) {
-            scene_remove_body(scene, i);
+            list_remove(scene->bodies, i);
+            body_free(b);
+            scene->bodies_version++;
         }
         else {
-            body_tick(b, dt);
             i++;
         }
     }
 }
+
+/* Applies forces, removes bodies marked for removal along with their forces,
+ * and ticks the remaining bodies over dt.
+ */
+void scene_step(Scene *scene, double dt) {
+    apply_forces(scene);
+    if (scene->kinetic) {
+        kinetic_advance(scene, dt);
+        // Bodies have already moved, so only impulses remain to be applied
+        dt = 0.0;
+        drop_removed_events(scene->kinetic);
+    }
+    remove_bodies(scene);
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        body_tick(scene_get_body(scene, i), dt);
+    }
+}
+
+/* Ticks a scene over dt in n_steps substeps, which only the fast bodies and
+ * the tested forces acting on them take. Every force is applied at the first
+ * substep, and each fast body's force from then is applied again at every
+ * later one, after its tested forces are evaluated again. Every other body
+ * moves once over all of dt, collecting the impulses of every substep.
+ */
+void scene_substep(Scene *scene, double dt, size_t n_steps) {
+    apply_forces(scene);
+
+    // Drop fast bodies that are about to be freed, keeping the rest sorted
+    size_t n_fast = 0;
+    for (size_t i = 0; i < scene->n_fast; i++) {
+        Body *b = scene->fast_bodies[i];
+        if (!body_is_removed(b)) {
+            scene->fast_bodies[n_fast++] = b;
+        }
+    }
+    scene->n_fast = n_fast;
+    remove_bodies(scene);
+
+    for (size_t i = 0; i < scene->n_fast; i++) {
+        scene->fast_forces[i] = body_get_force(scene->fast_bodies[i]);
+    }
+    for (size_t i = 0; i < list_size(scene->forces); i++) {
+        Force *f = list_get(scene->forces, i);
+        if (!f->tester) {
+            continue;
+        }
+        for (size_t j = 0; j < list_size(f->bodies); j++) {
+            if (is_fast(scene, list_get(f->bodies, j))) {
+                list_add(scene->substep_forces, f);
+                break;
+            }
+        }
+    }
+
+    double step = dt / n_steps;
+    for (size_t i = 0; i < n_steps; i++) {
+        if (i > 0) {
+            for (size_t j = 0; j < list_size(scene->substep_forces); j++) {
+                Force *f = list_get(scene->substep_forces, j);
+                if (force_bodies_exist(f)) {
+                    list_add(scene->batch, f);
+                }
+            }
+            run_batch(scene);
+        }
+        for (size_t j = 0; j < scene->n_fast; j++) {
+            Body *b = scene->fast_bodies[j];
+            if (body_is_removed(b)) {
+                continue;
+            }
+            if (i > 0) {
+                body_add_force(b, scene->fast_forces[j]);
+            }
+            body_tick(b, step);
+        }
+    }
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *b = scene_get_body(scene, i);
+        if (!body_is_removed(b) && !is_fast(scene, b)) {
+            body_tick(b, dt);
+        }
+    }
+
+    // Bodies removed by later substeps are freed now, as after a single step
+    clear_list(scene->substep_forces);
+    scene->n_fast = 0;
+    remove_bodies(scene);
+}
+
+void scene_tick(Scene *scene, double dt) {
+    if (scene->kinetic) {
+        scene_step(scene, dt);
+        return;
+    }
+    size_t n_steps = count_substeps(scene, dt);
+    if (n_steps == 1) {
+        scene_step(scene, dt);
+    }
+    else {
+        scene_substep(scene, dt, n_steps);
+    }
+}
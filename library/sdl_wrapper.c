@@ -4,7 +4,10 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL2_gfxPrimitives.h>
 #include <SDL2/SDL_ttf.h>
-#include <time.h>
+#include <stdint.h>
+#include <string.h>
+#include "polygon.h"
+#include "raster.h"
 #include "sdl_wrapper.h"
 
 #define WINDOW_TITLE "Swipe Brick Breaker"
@@ -14,6 +17,92 @@
 #define FONT_SIZE 24
 #define FONT_DIR "../font/font.ttf"  // May have to change to full file path
 #define TEXT_COLOR (SDL_Color) {255, 255, 255, 0}
+#define LABEL_HEIGHT 5.0         // Height of numeric labels, in scene units
+#define LABEL_DARK_LIGHTNESS 0.6    // Labels are black on lighter bodies
+#define TEXT_CACHE_SIZE 16      // # rendered strings kept as textures
+#define TEXT_MAX 64             // Longest cached string, including the '\0'
+#define TRIANGULATION_CACHE_SIZE 64 // # shapes whose triangles are kept
+#define SHAPE_PRECISION 1e4     // Shapes closer than 1 / this are the same
+#define MAX_DIRTY_RECTS 8       // More changed regions are merged into one
+#define SPRITE_CACHE_SIZE 64    // # (shape, color, scale)s kept as textures
+#define SPRITE_MAX_SIZE 64      // Larger shapes in pixels aren't sprites
+#define CIRCLE_MIN_POINTS 12    // Rounder shapes are rasterised as circles
+#define CIRCLE_TOLERANCE 0.01   // Relative spread of a circle's radii
+#define UNFOCUSED_FPS 30.0      // Most frames per second without input focus
+#define HIDDEN_FPS 4.0          // Most frames per second while not visible
+
+/**
+ * The triangles of a shape, shared by every polygon with that shape.
+ */
+typedef struct triangulation {
+    size_t n;           // # vertices of the shape
+    uint64_t key;       // See get_shape_key()
+    int *indices;       // 3 * (n - 2) indices of vertices
+} Triangulation;
+
+/**
+ * How the scene maps onto the window: a point (x, y) in the scene is drawn
+ * at (scale * x + x_offset, y_offset - scale * y) on screen.
+ */
+typedef struct viewport {
+    int width;          // Size of the window, in pixels
+    int height;
+    double scale;       // Pixels per scene unit
+    double x_offset;
+    double y_offset;
+    uint64_t version;   // Changes whenever the viewport does
+} Viewport;
+
+/**
+ * Four floats handled together by one SIMD instruction.
+ */
+typedef float Float4 __attribute__((vector_size(4 * sizeof(float))));
+
+/**
+ * A shape in a color, rasterised once at the current scale to a texture
+ * that is drawn wherever the shape is.
+ */
+typedef struct sprite {
+    uint64_t key;       // See get_sprite_key()
+    SDL_Texture *texture;
+    int width;
+    int height;
+    Vector origin;      // Where the shape's anchor is in the texture
+    size_t n_instances; // # times drawn in the current frame
+} Sprite;
+
+/**
+ * A sprite to draw at a point on screen this frame.
+ */
+typedef struct sprite_instance {
+    size_t sprite;
+    Vector position;    // Where the sprite's anchor is in the scene
+} SpriteInstance;
+
+/**
+ * A static body as it was last drawn into the static layer.
+ */
+typedef struct static_body {
+    const void *id;     // See snapshot_get_id()
+    List *shape;        // Only valid while its snapshot is being drawn
+    Vector centroid;
+    RGBColor color;
+    bool labelled;
+    size_t label;
+    SDL_Rect bounds;    // Pixels the body covers on screen
+} StaticBody;
+
+/**
+ * A string rendered to a texture, kept for as long as it is drawn often.
+ */
+typedef struct text_entry {
+    char text[TEXT_MAX];    // Empty if the entry is unused
+    int size;               // Font size the text was rendered at
+    SDL_Texture *texture;
+    int width;
+    int height;
+    uint64_t last_used;     // Value of text_clock when last requested
+} TextEntry;
 
 /**
  * The coordinate at the center of the screen.
@@ -27,6 +116,10 @@ Vector max_diff;
  * The SDL window where the scene is rendered.
  */
 SDL_Window *window;
+/**
+ * How the scene maps onto the window, updated when the window is resized.
+ */
+Viewport viewport;
 /**
  * The renderer used to draw the scene.
  */
@@ -41,15 +134,143 @@ KeyHandler key_handler = NULL;
  */
 uint32_t key_start_timestamp;
 /**
- * The value of clock() when time_since_last_tick() was last called.
+ * The most frames per second sdl_show() presents, or 0 for no limit.
+ */
+double frame_rate = 0;
+/**
+ * The performance counter when the next frame is due.
+ */
+uint64_t next_frame = 0;
+/**
+ * Whether input arrived or the window changed since the last frame was
+ * shown, so the next frame should be drawn even if the scene is the same.
+ */
+bool redraw_needed = true;
+/**
+ * The type of the events sdl_wake() pushes.
+ */
+Uint32 wake_event;
+/**
+ * Whether the window can be seen, and whether it has input focus.
+ */
+bool window_visible = true;
+bool window_focused = true;
+/**
+ * The performance counter when time_since_last_tick() was last called.
  * Initially 0.
  */
-clock_t last_clock = 0;
+uint64_t last_tick = 0;
 
 /**
  * Auxiliary information to be passed into KeyHandler function.
  */
 void *key_handler_aux = NULL;
+/**
+ * The font text is rendered in, opened once by sdl_init().
+ */
+TTF_Font *font = NULL;
+/**
+ * The most recently requested strings and their textures.
+ */
+TextEntry text_cache[TEXT_CACHE_SIZE];
+/**
+ * Counts requests for text, to find the least recently used entry.
+ */
+uint64_t text_clock = 0;
+/**
+ * The digits 0-9 rendered side by side in white, for drawing numbers.
+ */
+SDL_Texture *digit_atlas = NULL;
+/**
+ * Where each digit is in digit_atlas.
+ */
+SDL_Rect digit_rects[10];
+/**
+ * The shapes triangulated so far.
+ */
+Triangulation triangulations[TRIANGULATION_CACHE_SIZE];
+size_t n_triangulations = 0;
+/**
+ * The triangles of every polygon in the frame being drawn, submitted to the
+ * renderer by flush_batch(). Positions are packed (x, y) pairs in scene
+ * coordinates until flush_batch() converts them all to the screen at once.
+ */
+float *batch_xy = NULL;
+SDL_Color *batch_colors = NULL;
+float *batch_uv = NULL;     // Texture coordinates, only used by sprites
+int *batch_indices = NULL;
+size_t batch_n_vertices = 0, batch_n_indices = 0;
+size_t batch_max_vertices = 0, batch_max_indices = 0;
+/**
+ * The sprites rasterised so far, for the viewport with version
+ * sprite_version.
+ */
+Sprite sprites[SPRITE_CACHE_SIZE];
+size_t n_sprites = 0;
+uint64_t sprite_version = 0;
+/**
+ * The sprites to draw this frame, in the order they were added.
+ */
+SpriteInstance *sprite_instances = NULL;
+size_t n_sprite_instances = 0, max_sprite_instances = 0;
+/**
+ * The bodies that rarely change, drawn once into a texture and copied to the
+ * screen each frame, or NULL if the renderer can't draw into textures.
+ */
+SDL_Texture *static_layer = NULL;
+/**
+ * Whether static_layer has been drawn for the viewport with version
+ * static_layer_version.
+ */
+bool static_layer_valid = false;
+uint64_t static_layer_version = 0;
+/**
+ * The static bodies drawn in the layer, in the order they are drawn, and
+ * the list being built for the current frame. Each has the indices of its
+ * bodies sorted by address, to match them up between frames.
+ */
+StaticBody *static_bodies = NULL, *next_static_bodies = NULL;
+size_t *static_order = NULL, *next_static_order = NULL;
+size_t n_static_bodies = 0, max_static_bodies = 0;
+/**
+ * The list whose indices compare_static_bodies() is sorting.
+ */
+StaticBody *sorting_static_bodies;
+/**
+ * The regions of the static layer to redraw this frame.
+ */
+SDL_Rect dirty_rects[MAX_DIRTY_RECTS];
+size_t n_dirty_rects = 0;
+/**
+ * Whether scenes are drawn by the software rasteriser, into
+ * framebuffer_texture, instead of by the renderer.
+ */
+bool software_raster = false;
+/**
+ * The streaming texture the rasteriser draws to, sized for the viewport with
+ * version framebuffer_version.
+ */
+SDL_Texture *framebuffer_texture = NULL;
+uint64_t framebuffer_version = 0;
+/**
+ * A polygon's vertices in screen coordinates, as packed (x, y) pairs.
+ */
+float *raster_xy = NULL;
+size_t raster_max_vertices = 0;
+/**
+ * The function telling which bodies belong in the static layer, or NULL if
+ * none has been configured.
+ */
+StaticHandler static_handler = NULL;
+/**
+ * The function giving the number to draw on each body, or NULL if none has
+ * been configured.
+ */
+LabelHandler label_handler = NULL;
+/**
+ * Where sdl_render_scene() captures the scene it is asked to draw.
+ */
+Snapshot *scene_snapshot = NULL;
 
 /**
  * Converts an SDL key code to a char.
@@ -68,6 +289,58 @@ char get_keycode(SDL_Keycode key) {
     }
 }
 
+/**
+ * Renders each digit with the font, and copies them side by side into
+ * digit_atlas.
+ */
+void init_digit_atlas(void) {
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Surface *glyphs[10];
+    int width = 0, height = 0;
+    for (int i = 0; i < 10; i++) {
+        char digit[2] = {'0' + i, '\0'};
+        glyphs[i] = TTF_RenderText_Blended(font, digit, white);
+        assert(glyphs[i]);
+        digit_rects[i] = (SDL_Rect) {width, 0, glyphs[i]->w, glyphs[i]->h};
+        width += glyphs[i]->w;
+        if (glyphs[i]->h > height) {
+            height = glyphs[i]->h;
+        }
+    }
+
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(
+        0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    assert(atlas);
+    for (int i = 0; i < 10; i++) {
+        // Copy the glyph's alpha as is instead of blending it onto nothing
+        SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(glyphs[i], NULL, atlas, &digit_rects[i]);
+        SDL_FreeSurface(glyphs[i]);
+    }
+    digit_atlas = SDL_CreateTextureFromSurface(renderer, atlas);
+    assert(digit_atlas);
+    SDL_SetTextureBlendMode(digit_atlas, SDL_BLENDMODE_BLEND);
+    SDL_FreeSurface(atlas);
+}
+
+/**
+ * Scales the scene so it fits entirely in a window of the given size,
+ * with the center of the scene at the center of the window.
+ */
+void update_viewport(int width, int height) {
+    double x_scale = width / 2.0 / max_diff.x,
+           y_scale = height / 2.0 / max_diff.y;
+    double scale = x_scale < y_scale ? x_scale : y_scale;
+    viewport = (Viewport) {
+        .width = width,
+        .height = height,
+        .scale = scale,
+        .x_offset = width / 2.0 - scale * center.x,
+        .y_offset = height / 2.0 + scale * center.y,
+        .version = viewport.version + 1
+    };
+}
+
 void sdl_init(Vector min, Vector max) {
     // Check parameters
     assert(min.x < max.x);
@@ -85,107 +358,936 @@ void sdl_init(Vector min, Vector max) {
         SDL_WINDOW_RESIZABLE
     );
     renderer = SDL_CreateRenderer(window, -1, 0);
+    int width, height;
+    SDL_GetWindowSize(window, &width, &height);
+    update_viewport(width, height);
+    Uint32 flags = SDL_GetWindowFlags(window);
+    window_visible = !(flags & (SDL_WINDOW_HIDDEN | SDL_WINDOW_MINIMIZED));
+    wake_event = SDL_RegisterEvents(1);
+    assert(wake_event != (Uint32) -1);
+    scene_snapshot = snapshot_init();
 
     // Init TTF
     TTF_Init();
+    font = TTF_OpenFont(FONT_DIR, FONT_SIZE);
+    if (font == NULL) {
+      printf("Error: Could not open font from %s\n", FONT_DIR);
+      exit(1);
+    }
+    init_digit_atlas();
+}
+
+/**
+ * Handles an SDL event. Returns true if the window has been closed.
+ */
+bool handle_event(SDL_Event *event) {
+    switch (event->type) {
+        case SDL_QUIT:
+            return true;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            redraw_needed = true;
+            // Skip the keypress if no handler is configured
+            // or an unrecognized key was pressed
+            if (!key_handler) break;
+            char key = get_keycode(event->key.keysym.sym);
+            if (!key) break;
+
+            double timestamp = event->key.timestamp;
+            if (!event->key.repeat) {
+                key_start_timestamp = timestamp;
+            }
+            KeyEventType type =
+                event->type == SDL_KEYDOWN ? KEY_PRESSED : KEY_RELEASED;
+            double held_time =
+                (timestamp - key_start_timestamp) / MS_PER_S;
+            key_handler(key, type, held_time, key_handler_aux);
+            break;
+        case SDL_WINDOWEVENT:
+            switch (event->window.event) {
+                case SDL_WINDOWEVENT_SIZE_CHANGED:
+                    update_viewport(event->window.data1, event->window.data2);
+                    redraw_needed = true;
+                    break;
+                case SDL_WINDOWEVENT_SHOWN:
+                case SDL_WINDOWEVENT_RESTORED:
+                case SDL_WINDOWEVENT_MAXIMIZED:
+                    window_visible = true;
+                    redraw_needed = true;
+                    break;
+                case SDL_WINDOWEVENT_EXPOSED:
+                    redraw_needed = true;
+                    break;
+                case SDL_WINDOWEVENT_HIDDEN:
+                case SDL_WINDOWEVENT_MINIMIZED:
+                    window_visible = false;
+                    break;
+                case SDL_WINDOWEVENT_FOCUS_GAINED:
+                    window_focused = true;
+                    break;
+                case SDL_WINDOWEVENT_FOCUS_LOST:
+                    window_focused = false;
+                    break;
+            }
+            break;
+    }
+    return false;
 }
 
 bool sdl_is_done(void) {
-    SDL_Event *event = malloc(sizeof(*event));
-    assert(event);
-    while (SDL_PollEvent(event)) {
-        switch (event->type) {
-            case SDL_QUIT:
-                free(event);
-                return true;
-            case SDL_KEYDOWN:
-            case SDL_KEYUP:
-                // Skip the keypress if no handler is configured
-                // or an unrecognized key was pressed
-                if (!key_handler) break;
-                char key = get_keycode(event->key.keysym.sym);
-                if (!key) break;
-
-                double timestamp = event->key.timestamp;
-                if (!event->key.repeat) {
-                    key_start_timestamp = timestamp;
-                }
-                KeyEventType type =
-                    event->type == SDL_KEYDOWN ? KEY_PRESSED : KEY_RELEASED;
-                double held_time =
-                    (timestamp - key_start_timestamp) / MS_PER_S;
-                key_handler(key, type, held_time, key_handler_aux);
-                break;
-        }
-    }
-    free(event);
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        if (handle_event(&event)) {
+            return true;
+        }
+    }
     return false;
 }
 
+bool sdl_wait(double timeout) {
+    SDL_Event event;
+    bool done = SDL_WaitEventTimeout(&event, timeout * MS_PER_S)
+        && handle_event(&event);
+    return done || sdl_is_done();
+}
+
+void sdl_wake(void) {
+    SDL_Event event = {.type = wake_event};
+    SDL_PushEvent(&event);
+}
+
+bool sdl_needs_redraw(void) {
+    return redraw_needed;
+}
+
 void sdl_clear(void) {
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
     SDL_RenderClear(renderer);
 }
 
-void sdl_draw_polygon(List *points, RGBColor color) {
-    // Check parameters
+/**
+ * Converts a point in the scene to a point on screen.
+ */
+Vector to_screen(Vector point) {
+    return (Vector) {
+        viewport.scale * point.x + viewport.x_offset,
+        viewport.y_offset - viewport.scale * point.y
+    };
+}
+
+/**
+ * Converts n points in the scene, packed as (x, y) pairs, to points on
+ * screen in place, two points per SIMD operation.
+ */
+void transform_vertices(float *xy, size_t n) {
+    float scale = viewport.scale,
+          x_offset = viewport.x_offset,
+          y_offset = viewport.y_offset;
+    Float4 scales = {scale, -scale, scale, -scale};
+    Float4 offsets = {x_offset, y_offset, x_offset, y_offset};
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        Float4 points;
+        memcpy(&points, &xy[2 * i], sizeof(points));
+        points = points * scales + offsets;
+        memcpy(&xy[2 * i], &points, sizeof(points));
+    }
+    for (; i < n; i++) {
+        xy[2 * i] = xy[2 * i] * scale + x_offset;
+        xy[2 * i + 1] = y_offset - xy[2 * i + 1] * scale;
+    }
+}
+
+/**
+ * Hashes the lengths of a polygon's edges and the turns between them, which
+ * identify its shape wherever it is and however it is rotated.
+ */
+uint64_t get_shape_key(List *points) {
+    size_t n = list_size(points);
+    uint64_t key = 14695981039346656037ull;     // FNV-1a
+    for (size_t i = 0; i < n; i++) {
+        Vector a = v_cast(list_get(points, i));
+        Vector b = v_cast(list_get(points, (i + 1) % n));
+        Vector c = v_cast(list_get(points, (i + 2) % n));
+        Vector edge = vec_subtract(b, a);
+        int64_t values[2] = {
+            llround(sqrt(vec_dot(edge, edge)) * SHAPE_PRECISION),
+            llround(vec_cross(edge, vec_subtract(c, b)) * SHAPE_PRECISION)
+        };
+        for (size_t j = 0; j < 2; j++) {
+            key = (key ^ (uint64_t) values[j]) * 1099511628211ull;
+        }
+    }
+    return key;
+}
+
+/**
+ * Gets the triangles of a polygon's shape, triangulating it the first time
+ * the shape is drawn.
+ */
+int *get_triangles(List *points) {
+    size_t n = list_size(points);
+    uint64_t key = get_shape_key(points);
+    for (size_t i = 0; i < n_triangulations; i++) {
+        if (triangulations[i].n == n && triangulations[i].key == key) {
+            return triangulations[i].indices;
+        }
+    }
+
+    // Start over once there are too many shapes, e.g. from a rotating body
+    if (n_triangulations == TRIANGULATION_CACHE_SIZE) {
+        for (size_t i = 0; i < n_triangulations; i++) {
+            free(triangulations[i].indices);
+        }
+        n_triangulations = 0;
+    }
+    size_t *indices = malloc(sizeof(size_t) * 3 * (n - 2));
+    int *int_indices = malloc(sizeof(int) * 3 * (n - 2));
+    assert(indices);
+    assert(int_indices);
+    polygon_triangulate(points, indices);
+    for (size_t i = 0; i < 3 * (n - 2); i++) {
+        int_indices[i] = indices[i];
+    }
+    free(indices);
+    triangulations[n_triangulations++] = (Triangulation) {n, key, int_indices};
+    return int_indices;
+}
+
+/**
+ * Makes room in the batch for more vertices and indices.
+ */
+void reserve_batch(size_t n_vertices, size_t n_indices) {
+    if (batch_n_vertices + n_vertices > batch_max_vertices) {
+        batch_max_vertices = 2 * (batch_n_vertices + n_vertices);
+        batch_xy = realloc(batch_xy, sizeof(float) * 2 * batch_max_vertices);
+        batch_uv = realloc(batch_uv, sizeof(float) * 2 * batch_max_vertices);
+        batch_colors = realloc(batch_colors,
+            sizeof(SDL_Color) * batch_max_vertices);
+        assert(batch_xy && batch_uv && batch_colors);
+    }
+    if (batch_n_indices + n_indices > batch_max_indices) {
+        batch_max_indices = 2 * (batch_n_indices + n_indices);
+        batch_indices = realloc(batch_indices,
+            sizeof(int) * batch_max_indices);
+        assert(batch_indices);
+    }
+}
+
+/**
+ * Adds a polygon, moved by offset, to the frame's batch of triangles.
+ */
+void batch_polygon(List *points, Vector offset, RGBColor color) {
     size_t n = list_size(points);
     assert(n >= 3);
+    reserve_batch(n, 3 * (n - 2));
+
+    SDL_Color vertex_color = {
+        color.r * 255, color.g * 255, color.b * 255, 255
+    };
+    for (size_t i = 0; i < n; i++) {
+        Vector *vertex = list_get(points, i);
+        batch_xy[2 * (batch_n_vertices + i)] = vertex->x + offset.x;
+        batch_xy[2 * (batch_n_vertices + i) + 1] = vertex->y + offset.y;
+        batch_colors[batch_n_vertices + i] = vertex_color;
+    }
+    int *triangles = get_triangles(points);
+    for (size_t i = 0; i < 3 * (n - 2); i++) {
+        batch_indices[batch_n_indices++] = batch_n_vertices + triangles[i];
+    }
+    batch_n_vertices += n;
+}
+
+/**
+ * Hashes a polygon's vertices relative to its anchor and its color, and
+ * finds the size of the polygon around the anchor.
+ */
+uint64_t get_sprite_key(List *points, Vector anchor, RGBColor color,
+                        Vector *min, Vector *max) {
+    uint64_t key = 14695981039346656037ull;     // FNV-1a
+    int64_t rgb = llround(color.r * 255) << 16 | llround(color.g * 255) << 8
+        | llround(color.b * 255);
+    key = (key ^ (uint64_t) rgb) * 1099511628211ull;
+    *min = (Vector) {INFINITY, INFINITY};
+    *max = (Vector) {-INFINITY, -INFINITY};
+    for (size_t i = 0; i < list_size(points); i++) {
+        Vector v = vec_subtract(v_cast(list_get(points, i)), anchor);
+        int64_t values[2] = {
+            llround(v.x * SHAPE_PRECISION), llround(v.y * SHAPE_PRECISION)
+        };
+        for (size_t j = 0; j < 2; j++) {
+            key = (key ^ (uint64_t) values[j]) * 1099511628211ull;
+        }
+        *min = (Vector) {fmin(min->x, v.x), fmin(min->y, v.y)};
+        *max = (Vector) {fmax(max->x, v.x), fmax(max->y, v.y)};
+    }
+    return key;
+}
+
+/**
+ * Destroys every sprite's texture.
+ */
+void clear_sprites(void) {
+    for (size_t i = 0; i < n_sprites; i++) {
+        SDL_DestroyTexture(sprites[i].texture);
+    }
+    n_sprites = 0;
+}
+
+/**
+ * Rasterises a polygon, relative to its anchor, into a new sprite.
+ * Returns false if the renderer can't draw into textures.
+ */
+bool add_sprite(List *points, Vector anchor, RGBColor color, uint64_t key,
+                Vector min, Vector max) {
+    double scale = viewport.scale;
+    if (n_sprites == SPRITE_CACHE_SIZE) {
+        clear_sprites();
+    }
+    // A pixel to spare on each side
+    int width = ceil((max.x - min.x) * scale) + 2,
+        height = ceil((max.y - min.y) * scale) + 2;
+    SDL_Texture *texture = SDL_CreateTexture(renderer,
+        SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+    if (!texture) {
+        return false;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    Vector origin = {1 - min.x * scale, 1 + max.y * scale};
+
+    size_t n = list_size(points);
+    SDL_Vertex *vertices = malloc(sizeof(SDL_Vertex) * n);
+    assert(vertices);
+    SDL_Color vertex_color = {
+        color.r * 255, color.g * 255, color.b * 255, 255
+    };
+    for (size_t i = 0; i < n; i++) {
+        Vector v = vec_subtract(v_cast(list_get(points, i)), anchor);
+        vertices[i] = (SDL_Vertex) {
+            {origin.x + v.x * scale, origin.y - v.y * scale},
+            vertex_color,
+            {0, 0}
+        };
+    }
+    SDL_Texture *target = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, texture);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    SDL_RenderGeometry(renderer, NULL, vertices, n, get_triangles(points),
+        3 * (n - 2));
+    SDL_SetRenderTarget(renderer, target);
+    free(vertices);
+
+    sprites[n_sprites++] = (Sprite) {key, texture, width, height, origin, 0};
+    return true;
+}
+
+/**
+ * Adds the frame's sprites to the batch as textured quads, grouped by
+ * sprite, then converts the whole batch to the screen in one pass and draws
+ * it: all the polygons with one call, then each sprite's quads with one call.
+ * Empties the batch and the list of sprite instances.
+ */
+void flush_batch(void) {
+    size_t n_polygon_vertices = batch_n_vertices,
+           n_polygon_indices = batch_n_indices;
+    size_t first_vertices[SPRITE_CACHE_SIZE], first_indices[SPRITE_CACHE_SIZE];
+    size_t n_placed[SPRITE_CACHE_SIZE];
+    reserve_batch(4 * n_sprite_instances, 6 * n_sprite_instances);
+    for (size_t i = 0; i < n_sprites; i++) {
+        first_vertices[i] = batch_n_vertices;
+        first_indices[i] = batch_n_indices;
+        n_placed[i] = 0;
+        batch_n_vertices += 4 * sprites[i].n_instances;
+        batch_n_indices += 6 * sprites[i].n_instances;
+    }
+
+    SDL_Color white = {255, 255, 255, 255};
+    float uv[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+    int quad[6] = {0, 1, 2, 0, 2, 3};
+    for (size_t i = 0; i < n_sprite_instances; i++) {
+        Sprite *sprite = &sprites[sprite_instances[i].sprite];
+        size_t n = n_placed[sprite_instances[i].sprite]++;
+        size_t vertex = first_vertices[sprite_instances[i].sprite] + 4 * n,
+               index = first_indices[sprite_instances[i].sprite] + 6 * n;
+        // Corners of the texture, from the anchor's position in the scene
+        Vector p = sprite_instances[i].position;
+        double left = p.x - sprite->origin.x / viewport.scale,
+               right = p.x + (sprite->width - sprite->origin.x) / viewport.scale,
+               top = p.y + sprite->origin.y / viewport.scale,
+               bottom = p.y + (sprite->origin.y - sprite->height)
+                   / viewport.scale;
+        float corners[4][2] = {
+            {left, top}, {right, top}, {right, bottom}, {left, bottom}
+        };
+        memcpy(&batch_xy[2 * vertex], corners, sizeof(corners));
+        memcpy(&batch_uv[2 * vertex], uv, sizeof(uv));
+        for (size_t k = 0; k < 4; k++) {
+            batch_colors[vertex + k] = white;
+        }
+        for (size_t k = 0; k < 6; k++) {
+            batch_indices[index + k] = 4 * n + quad[k];
+        }
+    }
+
+    transform_vertices(batch_xy, batch_n_vertices);
+    if (n_polygon_indices > 0) {
+        SDL_RenderGeometryRaw(renderer, NULL,
+            batch_xy, 2 * sizeof(float),
+            batch_colors, sizeof(SDL_Color),
+            NULL, 0, n_polygon_vertices,
+            batch_indices, n_polygon_indices, sizeof(int));
+    }
+    for (size_t i = 0; i < n_sprites; i++) {
+        Sprite *sprite = &sprites[i];
+        if (sprite->n_instances == 0) {
+            continue;
+        }
+        size_t first = first_vertices[i];
+        SDL_RenderGeometryRaw(renderer, sprite->texture,
+            &batch_xy[2 * first], 2 * sizeof(float),
+            &batch_colors[first], sizeof(SDL_Color),
+            &batch_uv[2 * first], 2 * sizeof(float),
+            4 * sprite->n_instances,
+            &batch_indices[first_indices[i]], 6 * sprite->n_instances,
+            sizeof(int));
+        sprite->n_instances = 0;
+    }
+    batch_n_vertices = 0;
+    batch_n_indices = 0;
+    n_sprite_instances = 0;
+}
+
+/**
+ * Adds a small polygon, whose anchor is drawn at position, to the frame's
+ * sprites, rasterising it first if no sprite has its shape and color.
+ * Returns false if the polygon is too big for a sprite, or sprites can't be
+ * made, in which case it should be drawn as a polygon.
+ */
+bool batch_sprite(List *points, Vector anchor, Vector position,
+                    RGBColor color) {
+    if (viewport.version != sprite_version) {
+        clear_sprites();
+        sprite_version = viewport.version;
+    }
+    double scale = viewport.scale;
+    Vector min, max;
+    uint64_t key = get_sprite_key(points, anchor, color, &min, &max);
+    if ((max.x - min.x) * scale > SPRITE_MAX_SIZE
+        || (max.y - min.y) * scale > SPRITE_MAX_SIZE) {
+        return false;
+    }
+    size_t sprite = 0;
+    while (sprite < n_sprites && sprites[sprite].key != key) {
+        sprite++;
+    }
+    if (sprite == n_sprites) {
+        // Sprites may be cleared to make room, so draw this frame's first
+        if (n_sprites == SPRITE_CACHE_SIZE) {
+            flush_batch();
+        }
+        if (!add_sprite(points, anchor, color, key, min, max)) {
+            return false;
+        }
+        sprite = n_sprites - 1;
+    }
+
+    if (n_sprite_instances == max_sprite_instances) {
+        max_sprite_instances =
+            max_sprite_instances ? 2 * max_sprite_instances : 64;
+        sprite_instances = realloc(sprite_instances,
+            sizeof(SpriteInstance) * max_sprite_instances);
+        assert(sprite_instances);
+    }
+    sprite_instances[n_sprite_instances++] =
+        (SpriteInstance) {sprite, position};
+    sprites[sprite].n_instances++;
+    return true;
+}
+
+
+void sdl_draw_polygon(List *points, RGBColor color) {
     assert(0 <= color.r && color.r <= 1);
     assert(0 <= color.g && color.g <= 1);
     assert(0 <= color.b && color.b <= 1);
+    batch_polygon(points, VEC_ZERO, color);
+    flush_batch();
+}
 
-    // Scale scene so it fits entirely in the window,
-    // with the center of the scene at the center of the window
-    int *width = malloc(sizeof(*width)),
-        *height = malloc(sizeof(*height));
-    assert(width);
-    assert(height);
-    SDL_GetWindowSize(window, width, height);
-    double center_x = *width / 2.0,
-           center_y = *height / 2.0;
-    free(width);
-    free(height);
-    double x_scale = center_x / max_diff.x,
-           y_scale = center_y / max_diff.y;
-    double scale = x_scale < y_scale ? x_scale : y_scale;
+/**
+ * Draws a number centered on a point in the scene, one glyph from
+ * digit_atlas per digit. The number is black on light colors and white on
+ * dark ones.
+ */
+void draw_label(Vector position, size_t number, RGBColor background) {
+    double scale = viewport.scale;
+    Vector screen = to_screen(position);
 
-    // Convert each vertex to a point on screen
-    short *x_points = malloc(sizeof(*x_points) * n),
-          *y_points = malloc(sizeof(*y_points) * n);
-    assert(x_points);
-    assert(y_points);
-    for (size_t i = 0; i < n; i++) {
-        Vector *vertex = list_get(points, i);
-        Vector pos_from_center =
-            vec_multiply(scale, vec_subtract(*vertex, center));
-        // Flip y axis since positive y is down on the screen
-        x_points[i] = round(center_x + pos_from_center.x);
-        y_points[i] = round(center_y - pos_from_center.y);
+    char digits[21];
+    int n = sprintf(digits, "%zu", number);
+    double glyph_scale = LABEL_HEIGHT * scale / digit_rects[0].h;
+    double width = 0;
+    for (int i = 0; i < n; i++) {
+        width += digit_rects[digits[i] - '0'].w * glyph_scale;
     }
 
-    // Draw polygon with the given color
-    filledPolygonRGBA(
-        renderer,
-        x_points, y_points, n,
-        color.r * 255, color.g * 255, color.b * 255, 255
-    );
-    free(x_points);
-    free(y_points);
+    double lightness = (background.r + background.g + background.b) / 3;
+    Uint8 shade = lightness > LABEL_DARK_LIGHTNESS ? 0 : 255;
+    SDL_SetTextureColorMod(digit_atlas, shade, shade, shade);
+    double x = screen.x - width / 2;
+    double y = screen.y - LABEL_HEIGHT * scale / 2;
+    for (int i = 0; i < n; i++) {
+        SDL_Rect *glyph = &digit_rects[digits[i] - '0'];
+        SDL_Rect dest = {
+            round(x), round(y),
+            round(glyph->w * glyph_scale), round(glyph->h * glyph_scale)
+        };
+        SDL_RenderCopy(renderer, digit_atlas, glyph, &dest);
+        x += glyph->w * glyph_scale;
+    }
+}
+
+/**
+ * Sleeps until the next frame is due, at frame_rate frames per second, or
+ * fewer while the window is unfocused or hidden. Frames are due at fixed
+ * intervals, so waking early or late for one frame is made up in the next.
+ */
+void pace_frame(void) {
+    double fps = frame_rate;
+    if (!window_visible) {
+        fps = HIDDEN_FPS;
+    }
+    else if (!window_focused && (fps == 0 || fps > UNFOCUSED_FPS)) {
+        fps = UNFOCUSED_FPS;
+    }
+    uint64_t now = SDL_GetPerformanceCounter();
+    if (fps == 0) {
+        next_frame = now;
+        return;
+    }
+
+    uint64_t period = SDL_GetPerformanceFrequency() / fps;
+    next_frame += period;
+    // Start over after falling a frame behind, rather than rushing to catch
+    // up, or after the frame rate went up
+    if (next_frame + period < now || next_frame > now + period) {
+        next_frame = now + period;
+    }
+    if (next_frame > now) {
+        SDL_Delay((next_frame - now) * MS_PER_S
+            / SDL_GetPerformanceFrequency());
+    }
 }
 
 void sdl_show(void) {
     SDL_RenderPresent(renderer);
+    redraw_needed = false;
+    pace_frame();
+}
+
+/**
+ * Gets the pixels a polygon covers on screen, with a pixel to spare.
+ */
+SDL_Rect get_screen_bounds(List *points) {
+    double min_x = INFINITY, min_y = INFINITY;
+    double max_x = -INFINITY, max_y = -INFINITY;
+    for (size_t i = 0; i < list_size(points); i++) {
+        Vector screen = to_screen(v_cast(list_get(points, i)));
+        double x = screen.x, y = screen.y;
+        min_x = fmin(min_x, x);
+        max_x = fmax(max_x, x);
+        min_y = fmin(min_y, y);
+        max_y = fmax(max_y, y);
+    }
+    int x = floor(min_x) - 1, y = floor(min_y) - 1;
+    return (SDL_Rect) {x, y, ceil(max_x) + 1 - x, ceil(max_y) + 1 - y};
+}
+
+/**
+ * Marks a region of the static layer to be redrawn.
+ */
+void add_dirty_rect(SDL_Rect rect) {
+    if (n_dirty_rects == MAX_DIRTY_RECTS) {
+        SDL_Rect all = dirty_rects[0];
+        for (size_t i = 1; i < n_dirty_rects; i++) {
+            SDL_UnionRect(&all, &dirty_rects[i], &all);
+        }
+        dirty_rects[0] = all;
+        n_dirty_rects = 1;
+    }
+    dirty_rects[n_dirty_rects++] = rect;
+}
+
+/**
+ * Orders indices of static bodies in sorting_static_bodies by identity.
+ */
+int compare_static_bodies(const void *a, const void *b) {
+    uintptr_t body_a =
+        (uintptr_t) sorting_static_bodies[*(const size_t *) a].id;
+    uintptr_t body_b =
+        (uintptr_t) sorting_static_bodies[*(const size_t *) b].id;
+    return (body_a > body_b) - (body_a < body_b);
+}
+
+/**
+ * Whether a static body looks different from when it was drawn.
+ */
+bool static_body_changed(StaticBody *drawn, StaticBody *now) {
+    return !vec_equal(drawn->centroid, now->centroid)
+        || drawn->color.r != now->color.r
+        || drawn->color.g != now->color.g
+        || drawn->color.b != now->color.b
+        || drawn->labelled != now->labelled
+        || (now->labelled && drawn->label != now->label);
+}
+
+/**
+ * Lists the snapshot's static bodies, and marks the regions where one
+ * appeared, disappeared, moved or changed color or label since the last
+ * frame.
+ */
+void find_static_changes(Snapshot *snapshot) {
+    size_t n = 0;
+    for (size_t i = 0; i < snapshot_bodies(snapshot); i++) {
+        if (!snapshot_is_static(snapshot, i)) {
+            continue;
+        }
+        if (n == max_static_bodies) {
+            max_static_bodies = max_static_bodies ? 2 * max_static_bodies : 64;
+            static_bodies = realloc(static_bodies,
+                sizeof(StaticBody) * max_static_bodies);
+            next_static_bodies = realloc(next_static_bodies,
+                sizeof(StaticBody) * max_static_bodies);
+            static_order = realloc(static_order,
+                sizeof(size_t) * max_static_bodies);
+            next_static_order = realloc(next_static_order,
+                sizeof(size_t) * max_static_bodies);
+            assert(static_bodies && next_static_bodies);
+            assert(static_order && next_static_order);
+        }
+        next_static_order[n] = n;
+        StaticBody *entry = &next_static_bodies[n++];
+        entry->id = snapshot_get_id(snapshot, i);
+        entry->shape = snapshot_get_shape(snapshot, i);
+        entry->centroid = snapshot_get_centroid(snapshot, i);
+        entry->color = snapshot_get_color(snapshot, i);
+        entry->labelled = snapshot_get_label(snapshot, i, &entry->label);
+    }
+    sorting_static_bodies = next_static_bodies;
+    qsort(next_static_order, n, sizeof(size_t), compare_static_bodies);
+
+    // Merge with last frame's bodies, which are sorted the same way
+    size_t i = 0, j = 0;
+    while (i < n_static_bodies || j < n) {
+        StaticBody *drawn = i < n_static_bodies
+            ? &static_bodies[static_order[i]] : NULL;
+        StaticBody *now = j < n ? &next_static_bodies[next_static_order[j]]
+            : NULL;
+        if (drawn && now && drawn->id == now->id) {
+            if (static_body_changed(drawn, now)) {
+                now->bounds = get_screen_bounds(now->shape);
+                add_dirty_rect(drawn->bounds);
+                add_dirty_rect(now->bounds);
+            }
+            else {
+                now->bounds = drawn->bounds;
+            }
+            i++;
+            j++;
+        }
+        else if (drawn
+            && (!now || (uintptr_t) drawn->id < (uintptr_t) now->id)) {
+            add_dirty_rect(drawn->bounds);
+            i++;
+        }
+        else {
+            now->bounds = get_screen_bounds(now->shape);
+            add_dirty_rect(now->bounds);
+            j++;
+        }
+    }
+
+    StaticBody *swap = static_bodies;
+    static_bodies = next_static_bodies;
+    next_static_bodies = swap;
+    size_t *swap_order = static_order;
+    static_order = next_static_order;
+    next_static_order = swap_order;
+    n_static_bodies = n;
+}
+
+/**
+ * Redraws the static bodies in a region of the static layer.
+ */
+void draw_static_region(SDL_Rect region) {
+    SDL_RenderSetClipRect(renderer, &region);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderFillRect(renderer, &region);
+    for (size_t i = 0; i < n_static_bodies; i++) {
+        StaticBody *entry = &static_bodies[i];
+        if (SDL_HasIntersection(&entry->bounds, &region)) {
+            batch_polygon(entry->shape, VEC_ZERO, entry->color);
+        }
+    }
+    flush_batch();
+    for (size_t i = 0; i < n_static_bodies; i++) {
+        StaticBody *entry = &static_bodies[i];
+        if (entry->labelled && SDL_HasIntersection(&entry->bounds, &region)) {
+            draw_label(entry->centroid, entry->label, entry->color);
+        }
+    }
+    SDL_RenderSetClipRect(renderer, NULL);
+}
+
+/**
+ * Brings the static layer up to date with the scene, redrawing only the
+ * regions that changed, or all of it when the window changed.
+ * Returns false if there is no static layer to draw.
+ */
+bool update_static_layer(Snapshot *snapshot) {
+    int width = viewport.width, height = viewport.height;
+    n_dirty_rects = 0;
+    if (!static_layer_valid || viewport.version != static_layer_version) {
+        if (static_layer) {
+            SDL_DestroyTexture(static_layer);
+        }
+        static_layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+            SDL_TEXTUREACCESS_TARGET, width, height);
+        if (!static_layer) {
+            return false;
+        }
+        SDL_SetTextureBlendMode(static_layer, SDL_BLENDMODE_NONE);
+        n_static_bodies = 0;
+        add_dirty_rect((SDL_Rect) {0, 0, width, height});
+        static_layer_version = viewport.version;
+        static_layer_valid = true;
+    }
+
+    find_static_changes(snapshot);
+    if (n_dirty_rects > 0) {
+        SDL_SetRenderTarget(renderer, static_layer);
+        for (size_t i = 0; i < n_dirty_rects; i++) {
+            draw_static_region(dirty_rects[i]);
+        }
+        SDL_SetRenderTarget(renderer, NULL);
+    }
+    return true;
+}
+
+/**
+ * Packs a color as an ARGB8888 pixel.
+ */
+uint32_t pack_color(RGBColor color) {
+    return 0xff000000 | (uint32_t) (color.r * 255) << 16
+        | (uint32_t) (color.g * 255) << 8 | (uint32_t) (color.b * 255);
+}
+
+/**
+ * Checks whether a polygon, as packed (x, y) pairs, is a rectangle whose
+ * sides are parallel to the axes.
+ */
+bool is_axis_rect(const float *xy, size_t n) {
+    return n == 4 && (
+        (xy[0] == xy[2] && xy[3] == xy[5] && xy[4] == xy[6] && xy[7] == xy[1])
+        || (xy[1] == xy[3] && xy[2] == xy[4] && xy[5] == xy[7]
+            && xy[6] == xy[0]));
+}
+
+/**
+ * Checks whether a polygon, as packed (x, y) pairs, has enough vertices at
+ * the same distance from their average to be drawn as a circle, and finds
+ * that circle.
+ */
+bool is_circle(const float *xy, size_t n, float *x, float *y, float *radius) {
+    if (n < CIRCLE_MIN_POINTS) {
+        return false;
+    }
+    float sum_x = 0, sum_y = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum_x += xy[2 * i];
+        sum_y += xy[2 * i + 1];
+    }
+    *x = sum_x / n;
+    *y = sum_y / n;
+    float min_r = INFINITY, max_r = 0, sum_r = 0;
+    for (size_t i = 0; i < n; i++) {
+        float r = hypotf(xy[2 * i] - *x, xy[2 * i + 1] - *y);
+        min_r = fminf(min_r, r);
+        max_r = fmaxf(max_r, r);
+        sum_r += r;
+    }
+    *radius = sum_r / n;
+    return max_r - min_r <= CIRCLE_TOLERANCE * *radius;
+}
+
+/**
+ * Checks whether a polygon, as packed (x, y) pairs, is convex.
+ */
+bool is_convex(const float *xy, size_t n) {
+    bool has_left = false, has_right = false;
+    for (size_t i = 0; i < n; i++) {
+        size_t j = (i + 1) % n, k = (i + 2) % n;
+        float turn = (xy[2 * j] - xy[2 * i]) * (xy[2 * k + 1] - xy[2 * j + 1])
+            - (xy[2 * j + 1] - xy[2 * i + 1]) * (xy[2 * k] - xy[2 * j]);
+        has_left |= turn > 0;
+        has_right |= turn < 0;
+    }
+    return !(has_left && has_right);
+}
+
+/**
+ * Rasterises a polygon, moved by offset, with the fastest fill that draws
+ * its shape: rectangles and circles directly, other convex polygons by
+ * their edges, and the rest by their triangles.
+ */
+void raster_polygon(Framebuffer *buffer, List *points, Vector offset,
+                    RGBColor color) {
+    size_t n = list_size(points);
+    assert(n >= 3);
+    if (n > raster_max_vertices) {
+        raster_max_vertices = 2 * n;
+        raster_xy = realloc(raster_xy,
+            sizeof(float) * 2 * raster_max_vertices);
+        assert(raster_xy);
+    }
+    for (size_t i = 0; i < n; i++) {
+        Vector *vertex = list_get(points, i);
+        raster_xy[2 * i] = vertex->x + offset.x;
+        raster_xy[2 * i + 1] = vertex->y + offset.y;
+    }
+    transform_vertices(raster_xy, n);
+
+    uint32_t pixel = pack_color(color);
+    float x, y, radius;
+    if (is_axis_rect(raster_xy, n)) {
+        raster_fill_rect(buffer, raster_xy[0], raster_xy[1],
+            raster_xy[4], raster_xy[5], pixel);
+    }
+    else if (is_circle(raster_xy, n, &x, &y, &radius)) {
+        raster_fill_circle(buffer, x, y, radius, pixel);
+    }
+    else if (is_convex(raster_xy, n)) {
+        raster_fill_convex(buffer, raster_xy, n, pixel);
+    }
+    else {
+        int *triangles = get_triangles(points);
+        for (size_t i = 0; i < 3 * (n - 2); i += 3) {
+            float triangle[6];
+            for (size_t j = 0; j < 3; j++) {
+                triangle[2 * j] = raster_xy[2 * triangles[i + j]];
+                triangle[2 * j + 1] = raster_xy[2 * triangles[i + j] + 1];
+            }
+            raster_fill_convex(buffer, triangle, 3, pixel);
+        }
+    }
+}
+
+/**
+ * Draws all bodies in a snapshot, then the particles over them, with the
+ * software rasteriser, and copies the result to the renderer.
+ */
+void raster_snapshot(Snapshot *snapshot) {
+    if (!framebuffer_texture || framebuffer_version != viewport.version) {
+        if (framebuffer_texture) {
+            SDL_DestroyTexture(framebuffer_texture);
+        }
+        framebuffer_texture = SDL_CreateTexture(renderer,
+            SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+            viewport.width, viewport.height);
+        assert(framebuffer_texture);
+        framebuffer_version = viewport.version;
+    }
+    void *pixels;
+    int pitch;
+    int locked = SDL_LockTexture(framebuffer_texture, NULL, &pixels, &pitch);
+    assert(locked == 0);
+    Framebuffer buffer = {
+        pixels, viewport.width, viewport.height, pitch / sizeof(uint32_t)
+    };
+
+    raster_clear(&buffer, pack_color((RGBColor) {1, 1, 1}));
+    size_t body_count = snapshot_bodies(snapshot);
+    for (size_t i = 0; i < body_count; i++) {
+        raster_polygon(&buffer, snapshot_get_shape(snapshot, i), VEC_ZERO,
+            snapshot_get_color(snapshot, i));
+    }
+    size_t particle_count = snapshot_particles(snapshot);
+    for (size_t i = 0; i < particle_count; i++) {
+        raster_polygon(&buffer, snapshot_get_particle_shape(snapshot, i),
+            snapshot_get_particle_position(snapshot, i),
+            snapshot_get_particle_color(snapshot, i));
+    }
+    SDL_UnlockTexture(framebuffer_texture);
+    SDL_RenderCopy(renderer, framebuffer_texture, NULL, NULL);
 }
 
-void sdl_render_scene(Scene *scene, List *texture, List *rect) {
-    sdl_clear();
-    size_t body_count = scene_bodies(scene);
+/**
+ * Draws all bodies in a snapshot, then the particles over them, with the
+ * renderer. Returns whether the static bodies were copied from static_layer,
+ * in which case their labels are already drawn.
+ */
+bool draw_snapshot(Snapshot *snapshot) {
+    // Bodies that rarely change are copied from the static layer, and the
+    // rest of the bodies and particles are drawn in one batch of triangles
+    bool layered = static_handler && update_static_layer(snapshot);
+    if (layered) {
+        SDL_RenderCopy(renderer, static_layer, NULL, NULL);
+    }
+    else {
+        sdl_clear();
+    }
+    size_t body_count = snapshot_bodies(snapshot);
     for (size_t i = 0; i < body_count; i++) {
-        Body *body = scene_get_body(scene, i);
-        List *shape = body_get_shape(body);
-        sdl_draw_polygon(shape, body_get_color(body));
-        list_free(shape);
+        if (layered && snapshot_is_static(snapshot, i)) {
+            continue;
+        }
+        List *shape = snapshot_get_shape(snapshot, i);
+        Vector centroid = snapshot_get_centroid(snapshot, i);
+        RGBColor color = snapshot_get_color(snapshot, i);
+        if (!batch_sprite(shape, centroid, centroid, color)) {
+            batch_polygon(shape, VEC_ZERO, color);
+        }
+    }
+    // Particles share their prototype's shape, so it is drawn at each one
+    size_t particle_count = snapshot_particles(snapshot);
+    for (size_t i = 0; i < particle_count; i++) {
+        List *shape = snapshot_get_particle_shape(snapshot, i);
+        Vector position = snapshot_get_particle_position(snapshot, i);
+        RGBColor color = snapshot_get_particle_color(snapshot, i);
+        if (!batch_sprite(shape, VEC_ZERO, position, color)) {
+            batch_polygon(shape, position, color);
+        }
+    }
+    // Sprites are small, so they go over the larger polygons
+    flush_batch();
+    return layered;
+}
+
+void sdl_render_snapshot(Snapshot *snapshot, List *texture, List *rect) {
+    // Nothing would be seen, so only wait for the next frame
+    if (!window_visible) {
+        pace_frame();
+        return;
+    }
+
+    bool layered = false;
+    if (software_raster) {
+        raster_snapshot(snapshot);
+    }
+    else {
+        layered = draw_snapshot(snapshot);
+    }
+
+    size_t body_count = snapshot_bodies(snapshot);
+    for (size_t i = 0; i < body_count; i++) {
+        size_t number;
+        if (layered && snapshot_is_static(snapshot, i)) {
+            continue;
+        }
+        if (snapshot_get_label(snapshot, i, &number)) {
+            draw_label(snapshot_get_centroid(snapshot, i), number,
+                snapshot_get_color(snapshot, i));
+        }
     }
     for (size_t i = 0; i < list_size(texture); i++) {
         SDL_RenderCopy(renderer, list_get(texture, i), NULL, list_get(rect, i));
@@ -193,39 +1295,135 @@ void sdl_render_scene(Scene *scene, List *texture, List *rect) {
     sdl_show();
 }
 
+void sdl_render_scene(Scene *scene, ParticleSystem *particles,
+                        List *texture, List *rect) {
+    snapshot_capture(scene_snapshot, scene, particles, static_handler,
+        label_handler);
+    sdl_render_snapshot(scene_snapshot, texture, rect);
+}
+
 void sdl_on_key(KeyHandler handler, void *aux) {
     key_handler = handler;
     key_handler_aux = aux;
 }
 
+void sdl_on_label(LabelHandler handler) {
+    label_handler = handler;
+    static_layer_valid = false;
+}
+
+void sdl_set_vsync(bool enabled) {
+    SDL_RenderSetVSync(renderer, enabled);
+}
+
+void sdl_set_frame_rate(double fps) {
+    assert(fps >= 0);
+    frame_rate = fps;
+}
+
+void sdl_use_software_raster(bool enabled) {
+    software_raster = enabled;
+}
+
+void sdl_on_static(StaticHandler handler) {
+    static_handler = handler;
+    static_layer_valid = false;
+}
+
 double time_since_last_tick(void) {
-    clock_t now = clock();
-    double difference = last_clock
-        ? (double) (now - last_clock) / CLOCKS_PER_SEC
+    uint64_t now = SDL_GetPerformanceCounter();
+    double difference = last_tick
+        ? (double) (now - last_tick) / SDL_GetPerformanceFrequency()
         : 0.0; // return 0 the first time this is called
-    last_clock = now;
+    last_tick = now;
     return difference;
 }
 
-void get_text_and_rect(int x, int y, char *text, SDL_Texture **texture,
-  SDL_Rect *rect) {
-    TTF_Font *font = TTF_OpenFont(FONT_DIR, FONT_SIZE);
-
-    if (font == NULL) {
-      printf("Error: Could not open font from %s\n", FONT_DIR);
-      exit(1);
+/**
+ * Finds the cache entry for a string rendered at a font size, rendering it
+ * over the least recently used entry if it isn't cached.
+ */
+TextEntry *get_text_entry(char *text, int size) {
+    assert(strlen(text) < TEXT_MAX);
+    text_clock++;
+    TextEntry *lru = &text_cache[0];
+    for (size_t i = 0; i < TEXT_CACHE_SIZE; i++) {
+        TextEntry *entry = &text_cache[i];
+        if (entry->size == size && strcmp(entry->text, text) == 0
+            && entry->texture) {
+            entry->last_used = text_clock;
+            return entry;
+        }
+        if (entry->last_used < lru->last_used) {
+            lru = entry;
+        }
     }
 
+    if (lru->texture) {
+        SDL_DestroyTexture(lru->texture);
+    }
     SDL_Color textColor = TEXT_COLOR;
     SDL_Surface *surface = TTF_RenderText_Solid(font, text, textColor);
-    TTF_CloseFont(font);
-
-    *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    int text_width = surface->w;
-    int text_height = surface->h;
+    assert(surface);
+    lru->texture = SDL_CreateTextureFromSurface(renderer, surface);
+    lru->width = surface->w;
+    lru->height = surface->h;
     SDL_FreeSurface(surface);
+    strcpy(lru->text, text);
+    lru->size = size;
+    lru->last_used = text_clock;
+    return lru;
+}
+
+void get_text_and_rect(int x, int y, char *text, SDL_Texture **texture,
+  SDL_Rect *rect) {
+    TextEntry *entry = get_text_entry(text, FONT_SIZE);
+    *texture = entry->texture;
     rect->x = x;
     rect->y = y;
-    rect->w = text_width;
-    rect->h = text_height;
+    rect->w = entry->width;
+    rect->h = entry->height;
+}
+
+void sdl_quit(void) {
+    for (size_t i = 0; i < TEXT_CACHE_SIZE; i++) {
+        if (text_cache[i].texture) {
+            SDL_DestroyTexture(text_cache[i].texture);
+        }
+        text_cache[i] = (TextEntry) {.texture = NULL};
+    }
+    clear_sprites();
+    for (size_t i = 0; i < n_triangulations; i++) {
+        free(triangulations[i].indices);
+    }
+    n_triangulations = 0;
+    SDL_DestroyTexture(digit_atlas);
+    digit_atlas = NULL;
+    if (static_layer) {
+        SDL_DestroyTexture(static_layer);
+        static_layer = NULL;
+    }
+    if (framebuffer_texture) {
+        SDL_DestroyTexture(framebuffer_texture);
+        framebuffer_texture = NULL;
+    }
+
+    free(batch_xy);
+    free(batch_colors);
+    free(batch_uv);
+    free(batch_indices);
+    free(sprite_instances);
+    free(static_bodies);
+    free(next_static_bodies);
+    free(static_order);
+    free(next_static_order);
+    free(raster_xy);
+    snapshot_free(scene_snapshot);
+
+    TTF_CloseFont(font);
+    font = NULL;
+    TTF_Quit();
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
 }
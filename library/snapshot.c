@@ -0,0 +1,369 @@
+#include "snapshot.h"
+#include "polygon.h"
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define N_SLOTS 3           // Snapshots in a buffer
+#define FRESH 4             // Set in shared when it holds an unseen snapshot
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+typedef struct snapshot {
+    uint64_t hash;          // Of everything captured, to tell captures apart
+    const Scene *scene;     // Scene whose bodies the shapes were copied from
+    size_t bodies_version;  // See scene_get_bodies_version()
+    size_t n_bodies;
+    size_t max_bodies;
+    // One entry per body in each array
+    const void **ids;
+    size_t *versions;       // See body_get_motion_version()
+    List **copies;          // Each body's shape when its motion last changed
+    Vector *copy_centroids; // Its centroid then
+    List **shapes;          // Copies moved to the centroid, when asked for
+    bool *placed;           // Whether shapes holds the moved copy
+    Vector *centroids;
+    RGBColor *colors;
+    bool *statics;
+    bool *labelled;
+    size_t *labels;
+
+    size_t n_particles;
+    size_t max_particles;
+    // One entry per particle in each array
+    Vector *positions;
+    size_t *prototypes;
+
+    // Copies of the prototypes of particles captured from source
+    ParticleSystem *source;
+    size_t n_prototypes;
+    List **prototype_shapes;
+    RGBColor *prototype_colors;
+} Snapshot;
+
+typedef struct snapshot_buffer {
+    Snapshot *slots[N_SLOTS];
+    int back;               // Only used by the capturing thread
+    int front;              // Only used by the drawing thread
+    bool has_front;
+    uint64_t published_hash;    // Hash of the last published snapshot
+    atomic_int shared;      // The slot in between, plus FRESH if it is new
+    atomic_size_t changes;  // # snapshots published
+} SnapshotBuffer;
+
+
+/* Adds some bytes to an FNV-1a hash. */
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/* Makes a list of vertices a copy of a shape, reusing its vertices. */
+void copy_shape(List *copy, List *shape) {
+    size_t n = list_size(shape);
+    while (list_size(copy) > n) {
+        free(list_remove(copy, list_size(copy) - 1));
+    }
+    for (size_t i = 0; i < n; i++) {
+        Vector vertex = v_cast(list_get(shape, i));
+        if (i < list_size(copy)) {
+            *(Vector *) list_get(copy, i) = vertex;
+        }
+        else {
+            list_add(copy, vp_init(vertex));
+        }
+    }
+}
+
+/* Reallocates every body array of a snapshot to hold max_bodies bodies. */
+void snapshot_resize_bodies(Snapshot *snapshot, size_t max_bodies) {
+    snapshot->ids = realloc(snapshot->ids, sizeof(void *) * max_bodies);
+    snapshot->versions =
+        realloc(snapshot->versions, sizeof(size_t) * max_bodies);
+    snapshot->copies = realloc(snapshot->copies, sizeof(List *) * max_bodies);
+    snapshot->copy_centroids =
+        realloc(snapshot->copy_centroids, sizeof(Vector) * max_bodies);
+    snapshot->shapes = realloc(snapshot->shapes, sizeof(List *) * max_bodies);
+    snapshot->placed = realloc(snapshot->placed, sizeof(bool) * max_bodies);
+    snapshot->centroids =
+        realloc(snapshot->centroids, sizeof(Vector) * max_bodies);
+    snapshot->colors = realloc(snapshot->colors, sizeof(RGBColor) * max_bodies);
+    snapshot->statics = realloc(snapshot->statics, sizeof(bool) * max_bodies);
+    snapshot->labelled = realloc(snapshot->labelled, sizeof(bool) * max_bodies);
+    snapshot->labels = realloc(snapshot->labels, sizeof(size_t) * max_bodies);
+    assert(snapshot->ids && snapshot->versions);
+    assert(snapshot->copies && snapshot->copy_centroids);
+    assert(snapshot->shapes && snapshot->placed);
+    assert(snapshot->centroids && snapshot->colors);
+    assert(snapshot->statics && snapshot->labelled && snapshot->labels);
+    for (size_t i = snapshot->max_bodies; i < max_bodies; i++) {
+        snapshot->copies[i] = list_init(4, free);
+        snapshot->shapes[i] = list_init(4, free);
+    }
+    snapshot->max_bodies = max_bodies;
+}
+
+/* Reallocates every particle array of a snapshot to hold max_particles. */
+void snapshot_resize_particles(Snapshot *snapshot, size_t max_particles) {
+    snapshot->positions =
+        realloc(snapshot->positions, sizeof(Vector) * max_particles);
+    snapshot->prototypes =
+        realloc(snapshot->prototypes, sizeof(size_t) * max_particles);
+    assert(snapshot->positions && snapshot->prototypes);
+    snapshot->max_particles = max_particles;
+}
+
+/* Frees the copies of a snapshot's prototypes. */
+void snapshot_clear_prototypes(Snapshot *snapshot) {
+    for (size_t i = 0; i < snapshot->n_prototypes; i++) {
+        list_free(snapshot->prototype_shapes[i]);
+    }
+    free(snapshot->prototype_shapes);
+    free(snapshot->prototype_colors);
+    snapshot->prototype_shapes = NULL;
+    snapshot->prototype_colors = NULL;
+    snapshot->n_prototypes = 0;
+}
+
+/* Copies the prototypes of particles up to and including prototype. */
+void snapshot_copy_prototypes(Snapshot *snapshot, size_t prototype) {
+    ParticleSystem *particles = snapshot->source;
+    size_t n = prototype + 1;
+    snapshot->prototype_shapes =
+        realloc(snapshot->prototype_shapes, sizeof(List *) * n);
+    snapshot->prototype_colors =
+        realloc(snapshot->prototype_colors, sizeof(RGBColor) * n);
+    assert(snapshot->prototype_shapes && snapshot->prototype_colors);
+    for (size_t i = snapshot->n_prototypes; i < n; i++) {
+        List *shape = list_init(4, free);
+        copy_shape(shape, particles_get_shape(particles, i));
+        snapshot->prototype_shapes[i] = shape;
+        snapshot->prototype_colors[i] = particles_get_color(particles, i);
+    }
+    snapshot->n_prototypes = n;
+}
+
+Snapshot *snapshot_init(void) {
+    Snapshot *snapshot = calloc(1, sizeof(Snapshot));
+    assert(snapshot);
+    return snapshot;
+}
+
+void snapshot_free(Snapshot *snapshot) {
+    for (size_t i = 0; i < snapshot->max_bodies; i++) {
+        list_free(snapshot->copies[i]);
+        list_free(snapshot->shapes[i]);
+    }
+    free(snapshot->ids);
+    free(snapshot->versions);
+    free(snapshot->copies);
+    free(snapshot->copy_centroids);
+    free(snapshot->shapes);
+    free(snapshot->placed);
+    free(snapshot->centroids);
+    free(snapshot->colors);
+    free(snapshot->statics);
+    free(snapshot->labelled);
+    free(snapshot->labels);
+    free(snapshot->positions);
+    free(snapshot->prototypes);
+    snapshot_clear_prototypes(snapshot);
+    free(snapshot);
+}
+
+void snapshot_capture(Snapshot *snapshot, Scene *scene,
+                        ParticleSystem *particles, StaticHandler is_static,
+                        LabelHandler get_label) {
+    size_t n_bodies = scene_bodies(scene);
+    if (n_bodies > snapshot->max_bodies) {
+        snapshot_resize_bodies(snapshot, 2 * n_bodies);
+    }
+    // While the scene has the same bodies, a body whose motion didn't change
+    // only moved along its velocity, so its copied shape can still be moved
+    // to its centroid instead of being copied again
+    size_t bodies_version = scene_get_bodies_version(scene);
+    bool same_bodies = snapshot->scene == scene
+        && snapshot->bodies_version == bodies_version;
+    for (size_t i = 0; i < n_bodies; i++) {
+        Body *body = scene_get_body(scene, i);
+        size_t version = body_get_motion_version(body);
+        Vector centroid = body_get_centroid(body);
+        if (!same_bodies || snapshot->versions[i] != version) {
+            copy_shape(snapshot->copies[i], body_borrow_shape(body));
+            snapshot->copy_centroids[i] = centroid;
+        }
+        snapshot->ids[i] = body;
+        snapshot->versions[i] = version;
+        snapshot->placed[i] = false;
+        snapshot->centroids[i] = centroid;
+        snapshot->colors[i] = body_get_color(body);
+        snapshot->statics[i] = is_static && is_static(body);
+        snapshot->labelled[i] = get_label && get_label(body,
+            &snapshot->labels[i]);
+    }
+    snapshot->scene = scene;
+    snapshot->bodies_version = bodies_version;
+    snapshot->n_bodies = n_bodies;
+
+    if (particles != snapshot->source) {
+        snapshot_clear_prototypes(snapshot);
+        snapshot->source = particles;
+    }
+    size_t n_particles = particles ? particles_size(particles) : 0;
+    if (n_particles > snapshot->max_particles) {
+        snapshot_resize_particles(snapshot, 2 * n_particles);
+    }
+    for (size_t i = 0; i < n_particles; i++) {
+        size_t prototype = particles_get_prototype(particles, i);
+        if (prototype >= snapshot->n_prototypes) {
+            snapshot_copy_prototypes(snapshot, prototype);
+        }
+        snapshot->positions[i] = particles_get_position(particles, i);
+        snapshot->prototypes[i] = prototype;
+    }
+    snapshot->n_particles = n_particles;
+
+    // Shapes are implied by the bodies' motion versions and centroids, shapes
+    // of particles by their prototypes, and labels only matter on labelled
+    // bodies
+    uint64_t hash = hash_bytes(FNV_OFFSET, &n_bodies, sizeof(n_bodies));
+    hash = hash_bytes(hash, &bodies_version, sizeof(bodies_version));
+    for (size_t i = 0; i < n_bodies; i++) {
+        size_t label = snapshot->labelled[i] ? snapshot->labels[i] : 0;
+        hash = hash_bytes(hash, &snapshot->ids[i], sizeof(void *));
+        hash = hash_bytes(hash, &snapshot->versions[i], sizeof(size_t));
+        hash = hash_bytes(hash, &snapshot->centroids[i], sizeof(Vector));
+        hash = hash_bytes(hash, &snapshot->colors[i], sizeof(RGBColor));
+        hash = hash_bytes(hash, &snapshot->statics[i], sizeof(bool));
+        hash = hash_bytes(hash, &snapshot->labelled[i], sizeof(bool));
+        hash = hash_bytes(hash, &label, sizeof(size_t));
+    }
+    hash = hash_bytes(hash, &n_particles, sizeof(n_particles));
+    hash = hash_bytes(hash, snapshot->positions, sizeof(Vector) * n_particles);
+    hash = hash_bytes(hash, snapshot->prototypes,
+        sizeof(size_t) * n_particles);
+    snapshot->hash = hash;
+}
+
+size_t snapshot_bodies(Snapshot *snapshot) {
+    return snapshot->n_bodies;
+}
+
+const void *snapshot_get_id(Snapshot *snapshot, size_t index) {
+    assert(index < snapshot->n_bodies);
+    return snapshot->ids[index];
+}
+
+List *snapshot_get_shape(Snapshot *snapshot, size_t index) {
+    assert(index < snapshot->n_bodies);
+    Vector offset = vec_subtract(snapshot->centroids[index],
+        snapshot->copy_centroids[index]);
+    if (vec_equal(offset, VEC_ZERO)) {
+        return snapshot->copies[index];
+    }
+    List *shape = snapshot->shapes[index];
+    if (!snapshot->placed[index]) {
+        copy_shape(shape, snapshot->copies[index]);
+        polygon_translate(shape, offset);
+        snapshot->placed[index] = true;
+    }
+    return shape;
+}
+
+Vector snapshot_get_centroid(Snapshot *snapshot, size_t index) {
+    assert(index < snapshot->n_bodies);
+    return snapshot->centroids[index];
+}
+
+RGBColor snapshot_get_color(Snapshot *snapshot, size_t index) {
+    assert(index < snapshot->n_bodies);
+    return snapshot->colors[index];
+}
+
+bool snapshot_is_static(Snapshot *snapshot, size_t index) {
+    assert(index < snapshot->n_bodies);
+    return snapshot->statics[index];
+}
+
+bool snapshot_get_label(Snapshot *snapshot, size_t index, size_t *number) {
+    assert(index < snapshot->n_bodies);
+    *number = snapshot->labels[index];
+    return snapshot->labelled[index];
+}
+
+size_t snapshot_particles(Snapshot *snapshot) {
+    return snapshot->n_particles;
+}
+
+Vector snapshot_get_particle_position(Snapshot *snapshot, size_t index) {
+    assert(index < snapshot->n_particles);
+    return snapshot->positions[index];
+}
+
+List *snapshot_get_particle_shape(Snapshot *snapshot, size_t index) {
+    assert(index < snapshot->n_particles);
+    return snapshot->prototype_shapes[snapshot->prototypes[index]];
+}
+
+RGBColor snapshot_get_particle_color(Snapshot *snapshot, size_t index) {
+    assert(index < snapshot->n_particles);
+    return snapshot->prototype_colors[snapshot->prototypes[index]];
+}
+
+SnapshotBuffer *snapshot_buffer_init(void) {
+    SnapshotBuffer *buffer = malloc(sizeof(SnapshotBuffer));
+    assert(buffer);
+    for (size_t i = 0; i < N_SLOTS; i++) {
+        buffer->slots[i] = snapshot_init();
+    }
+    buffer->back = 0;
+    buffer->front = 1;
+    buffer->has_front = false;
+    buffer->published_hash = 0;
+    atomic_init(&buffer->shared, 2);
+    atomic_init(&buffer->changes, 0);
+    return buffer;
+}
+
+void snapshot_buffer_free(SnapshotBuffer *buffer) {
+    for (size_t i = 0; i < N_SLOTS; i++) {
+        snapshot_free(buffer->slots[i]);
+    }
+    free(buffer);
+}
+
+Snapshot *snapshot_buffer_back(SnapshotBuffer *buffer) {
+    return buffer->slots[buffer->back];
+}
+
+bool snapshot_buffer_publish(SnapshotBuffer *buffer) {
+    Snapshot *back = buffer->slots[buffer->back];
+    if (atomic_load(&buffer->changes) > 0
+        && back->hash == buffer->published_hash) {
+        return false;
+    }
+    buffer->published_hash = back->hash;
+    // The exchange makes the capture visible to the drawing thread. Counting
+    // it afterwards means a new count always comes with a new snapshot.
+    buffer->back = atomic_exchange(&buffer->shared, buffer->back | FRESH)
+        & ~FRESH;
+    atomic_fetch_add(&buffer->changes, 1);
+    return true;
+}
+
+size_t snapshot_buffer_changes(SnapshotBuffer *buffer) {
+    return atomic_load(&buffer->changes);
+}
+
+Snapshot *snapshot_buffer_front(SnapshotBuffer *buffer) {
+    if (atomic_load(&buffer->shared) & FRESH) {
+        buffer->front = atomic_exchange(&buffer->shared, buffer->front)
+            & ~FRESH;
+        buffer->has_front = true;
+    }
+    return buffer->has_front ? buffer->slots[buffer->front] : NULL;
+}
@@ -0,0 +1,157 @@
+#include "timer.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define LEVEL_BITS 6                    // Each wheel has 2^LEVEL_BITS slots
+#define LEVEL_SLOTS (1 << LEVEL_BITS)
+#define LEVEL_MASK (LEVEL_SLOTS - 1)
+#define LEVELS 4                        // Wheels from finest to coarsest
+
+// Largest number of slots ahead a timer can be placed; later timers are
+// placed this far ahead, and placed again when they get there
+#define MAX_AHEAD ((1ull << (LEVEL_BITS * LEVELS)) - 1)
+
+typedef struct timer {
+    double time;
+    uint64_t slot;      // Absolute index of the slot the timer is due in
+    TimerCallback callback;
+    void *aux;
+    struct timer *next;
+} Timer;
+
+typedef struct timer_wheel {
+    double resolution;
+    double time;
+    uint64_t now;       // Absolute index of the current slot
+    Timer *slots[LEVELS][LEVEL_SLOTS];
+} TimerWheel;
+
+
+TimerWheel *timer_wheel_init(double resolution) {
+    assert(resolution > 0);
+    TimerWheel *wheel = calloc(1, sizeof(TimerWheel));
+    assert(wheel != NULL);
+    wheel->resolution = resolution;
+    return wheel;
+}
+
+/* Frees a linked list of timers. */
+void timer_list_free(Timer *timer) {
+    while (timer) {
+        Timer *next = timer->next;
+        free(timer);
+        timer = next;
+    }
+}
+
+void timer_wheel_free(TimerWheel *wheel) {
+    for (size_t level = 0; level < LEVELS; level++) {
+        for (size_t i = 0; i < LEVEL_SLOTS; i++) {
+            timer_list_free(wheel->slots[level][i]);
+        }
+    }
+    free(wheel);
+}
+
+/* Puts a timer in the slot of the finest wheel that reaches its slot. */
+void timer_wheel_place(TimerWheel *wheel, Timer *timer) {
+    uint64_t slot = timer->slot > wheel->now ? timer->slot : wheel->now;
+    uint64_t ahead = slot - wheel->now;
+    if (ahead > MAX_AHEAD) {
+        ahead = MAX_AHEAD;
+        slot = wheel->now + ahead;
+    }
+    size_t level = 0;
+    while ((ahead >> (LEVEL_BITS * (level + 1))) > 0) {
+        level++;
+    }
+    size_t i = (slot >> (LEVEL_BITS * level)) & LEVEL_MASK;
+    timer->next = wheel->slots[level][i];
+    wheel->slots[level][i] = timer;
+}
+
+void timer_wheel_schedule(TimerWheel *wheel, double time,
+                            TimerCallback callback, void *aux) {
+    Timer *timer = malloc(sizeof(Timer));
+    assert(timer != NULL);
+    double slot = time / wheel->resolution;
+    *timer = (Timer) {
+        .time = time,
+        .slot = slot > 0 ? (uint64_t) slot : 0,
+        .callback = callback,
+        .aux = aux,
+        .next = NULL
+    };
+    timer_wheel_place(wheel, timer);
+}
+
+/* Moves the timers in the current slot of a coarser wheel down to finer
+ * wheels, now that the current slot has reached it.
+ */
+void timer_wheel_cascade(TimerWheel *wheel, size_t level) {
+    size_t i = (wheel->now >> (LEVEL_BITS * level)) & LEVEL_MASK;
+    Timer *timer = wheel->slots[level][i];
+    wheel->slots[level][i] = NULL;
+    while (timer) {
+        Timer *next = timer->next;
+        timer_wheel_place(wheel, timer);
+        timer = next;
+    }
+}
+
+/* Calls back the timers in the current slot that are due by time, and keeps
+ * the rest.
+ */
+void timer_wheel_fire(TimerWheel *wheel, double time) {
+    size_t i = wheel->now & LEVEL_MASK;
+    Timer *timer = wheel->slots[0][i];
+    wheel->slots[0][i] = NULL;
+
+    // Timers are pushed onto the front of the slot, so reverse the due ones to
+    // call them in the order they were placed
+    Timer *due = NULL;
+    while (timer) {
+        Timer *next = timer->next;
+        if (timer->time <= time) {
+            timer->next = due;
+            due = timer;
+        }
+        else {
+            timer->next = wheel->slots[0][i];
+            wheel->slots[0][i] = timer;
+        }
+        timer = next;
+    }
+    while (due) {
+        Timer *next = due->next;
+        due->callback(due->aux);
+        free(due);
+        due = next;
+    }
+}
+
+void timer_wheel_advance(TimerWheel *wheel, double time) {
+    assert(time >= wheel->time);
+    wheel->time = time;
+    double slot = time / wheel->resolution;
+    uint64_t target = slot > 0 ? (uint64_t) slot : 0;
+    while (wheel->now < target) {
+        // Every timer in a slot before the target slot is due
+        timer_wheel_fire(wheel, INFINITY);
+        wheel->now++;
+        // A coarser wheel moves on a slot each time the finer ones wrap around
+        for (size_t level = 1; level < LEVELS; level++) {
+            if ((wheel->now & ((1ull << (LEVEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            timer_wheel_cascade(wheel, level);
+        }
+    }
+    timer_wheel_fire(wheel, time);
+}
+
+double timer_wheel_time(TimerWheel *wheel) {
+    return wheel->time;
+}
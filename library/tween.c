@@ -0,0 +1,101 @@
+#include "tween.h"
+#include <assert.h>
+#include <stdlib.h>
+
+typedef struct tween {
+    Body *body;
+    Vector start;
+    Vector target;
+    double elapsed;
+    double duration;
+    TweenCallback callback;
+    void *aux;
+} Tween;
+
+typedef struct tween_system {
+    Tween *tweens;      // In the order they were added
+    Tween *finished;    // Tweens finished this tick, waiting to call back,
+                        // with the same capacity as tweens
+    size_t size;
+    size_t capacity;
+} TweenSystem;
+
+
+/* Reallocates the arrays of a tween system to hold capacity tweens. */
+void tweens_resize(TweenSystem *tweens, size_t capacity) {
+    tweens->tweens = realloc(tweens->tweens, sizeof(Tween) * capacity);
+    tweens->finished = realloc(tweens->finished, sizeof(Tween) * capacity);
+    assert(tweens->tweens);
+    assert(tweens->finished);
+    tweens->capacity = capacity;
+}
+
+TweenSystem *tweens_init(size_t initial_size) {
+    TweenSystem *tweens = calloc(1, sizeof(TweenSystem));
+    assert(tweens);
+    tweens_resize(tweens, initial_size > 0 ? initial_size : 1);
+    return tweens;
+}
+
+void tweens_free(TweenSystem *tweens) {
+    free(tweens->tweens);
+    free(tweens->finished);
+    free(tweens);
+}
+
+void tweens_add(TweenSystem *tweens, Body *body, Vector target,
+                double duration, TweenCallback callback, void *aux) {
+    assert(duration >= 0);
+    if (tweens->size == tweens->capacity) {
+        tweens_resize(tweens, tweens->capacity * 2);
+    }
+    tweens->tweens[tweens->size++] = (Tween) {
+        .body = body,
+        .start = body_get_centroid(body),
+        .target = target,
+        .elapsed = 0.0,
+        .duration = duration,
+        .callback = callback,
+        .aux = aux
+    };
+}
+
+void tweens_tick(TweenSystem *tweens, double dt) {
+    size_t live = 0;
+    size_t n_finished = 0;
+    for (size_t i = 0; i < tweens->size; i++) {
+        Tween tween = tweens->tweens[i];
+        if (body_is_removed(tween.body)) {
+            continue;
+        }
+        tween.elapsed += dt;
+        if (tween.elapsed >= tween.duration) {
+            body_set_centroid(tween.body, tween.target);
+            tweens->finished[n_finished++] = tween;
+            continue;
+        }
+        double t = tween.elapsed / tween.duration;
+        Vector offset = vec_subtract(tween.target, tween.start);
+        body_set_centroid(tween.body,
+            vec_add(tween.start, vec_multiply(t, offset)));
+        tweens->tweens[live++] = tween;
+    }
+    tweens->size = live;
+    if (n_finished == 0) {
+        return;
+    }
+
+    // Callbacks may add tweens, which can reallocate the arrays but keeps
+    // their contents, so each finished tween is read again after the last
+    // callback
+    for (size_t i = 0; i < n_finished; i++) {
+        Tween tween = tweens->finished[i];
+        if (tween.callback) {
+            tween.callback(tween.body, tween.aux);
+        }
+    }
+}
+
+size_t tweens_size(TweenSystem *tweens) {
+    return tweens->size;
+}
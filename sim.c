@@ -0,0 +1,188 @@
+#include "breaker.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SIM_DT (1.0 / 60.0)     // Simulated time per tick, as at 60 FPS
+#define DEFAULT_ROUNDS 1000     // Rounds to play if not given with -n
+#define MAX_SCRIPT_ANGLES 256
+#define SUBSTEP_FRACTION 0.5    // Of its radius a ball may move per substep
+
+
+/* Chooses the aim for each volley. A scripted policy cycles through its
+ * angles; a policy without angles aims uniformly at random.
+ */
+typedef struct aim_policy {
+    double angles[MAX_SCRIPT_ANGLES];
+    size_t n_angles;
+    size_t next;
+} AimPolicy;
+
+/* Parses a comma-separated list of angles in degrees into policy. */
+void parse_script(AimPolicy *policy, char *script) {
+    policy->n_angles = 0;
+    for (char *tok = strtok(script, ","); tok; tok = strtok(NULL, ",")) {
+        assert(policy->n_angles < MAX_SCRIPT_ANGLES);
+        policy->angles[policy->n_angles++] = atof(tok) * M_PI / 180.0;
+    }
+}
+
+/* Returns the aim for the next volley. */
+double next_aim(AimPolicy *policy) {
+    if (policy->n_angles == 0) {
+        return -MAX_AIM + 2.0 * MAX_AIM * rand() / RAND_MAX;
+    }
+    double angle = policy->angles[policy->next];
+    policy->next = (policy->next + 1) % policy->n_angles;
+    return angle;
+}
+
+/* Returns the wall-clock time in seconds. */
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Prints the level, where the balls wait, and the number on every body, so
+ * that two runs can be compared round by round.
+ */
+void print_board(Scene *s) {
+    Vector ball_loc = body_get_centroid(scene_get_body_of_type(s, BALL, 0));
+    printf("level %zu: %zu balls at %.6f,", breaker_get_level(),
+        scene_bodies_of_type(s, BALL), ball_loc.x);
+    for (size_t i = 0; i < scene_bodies(s); i++) {
+        size_t number;
+        if (breaker_get_label(scene_get_body(s, i), &number)) {
+            printf(" %zu", number);
+        }
+    }
+    printf("\n");
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [-s seed] [-n rounds] [-a deg,deg,...] [-b board]"
+        " [-t steps] [-j threads] [-r] [-p]\n"
+        "  -s seed    seed for the game and the random policy (default 0)\n"
+        "  -n rounds  number of rounds to play (default %d)\n"
+        "  -a angles  aim by cycling through these angles, in degrees from\n"
+        "             vertical (default: aim at random)\n"
+        "  -b board   play every game on the endless board with this seed\n"
+        "  -t steps   tick in fixed steps instead of from collision to\n"
+        "             collision, splitting ticks into at most this many\n"
+        "             substeps for fast balls\n"
+        "  -j threads test collisions on this many threads (default 1)\n"
+        "  -r         have every ball collide instead of replaying the first\n"
+        "             ball's path\n"
+        "  -p         print the board after every round\n",
+        name, DEFAULT_ROUNDS);
+}
+
+/* Plays games headlessly, starting a new game after each game over, until the
+ * given number of rounds have been played. Reports rounds per second.
+ */
+int main(int argc, char *argv[]) {
+    unsigned int seed = 0;
+    size_t max_rounds = DEFAULT_ROUNDS;
+    AimPolicy policy = {.n_angles = 0, .next = 0};
+    bool endless = false;
+    unsigned int board_seed = 0;
+    size_t max_substeps = 0;    // 0 to tick from collision to collision
+    size_t n_threads = 1;
+    bool replay = true;
+    bool print = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:n:a:b:t:j:rp")) != -1) {
+        switch (opt) {
+            case 's':
+                seed = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                max_rounds = strtoul(optarg, NULL, 10);
+                break;
+            case 'a':
+                parse_script(&policy, optarg);
+                break;
+            case 'b':
+                endless = true;
+                board_seed = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                max_substeps = strtoul(optarg, NULL, 10);
+                if (max_substeps == 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'j':
+                n_threads = strtoul(optarg, NULL, 10);
+                if (n_threads == 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'r':
+                replay = false;
+                break;
+            case 'p':
+                print = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    srand(seed);
+
+    size_t rounds = 0;
+    size_t games_over = 0;
+    size_t total_score = 0;
+    double start = now();
+
+    while (rounds < max_rounds) {
+        Scene *s = endless ? breaker_init_endless(board_seed) : breaker_init();
+        scene_set_threads(s, n_threads);
+        breaker_set_replay(replay);
+        if (max_substeps > 0) {
+            scene_set_kinetic(s, false);
+            scene_set_substeps(s, SUBSTEP_FRACTION, max_substeps);
+        }
+        while (rounds < max_rounds) {
+            if (breaker_player_enabled()) {
+                breaker_set_aim(s, next_aim(&policy));
+                breaker_shoot(s);
+            }
+            size_t level = breaker_get_level();
+            bool alive = breaker_tick(s, SIM_DT);
+            if (breaker_get_level() != level) {
+                rounds++;
+                if (print) {
+                    print_board(s);
+                }
+            }
+            if (!alive) {
+                games_over++;
+                total_score += breaker_get_level();
+                break;
+            }
+        }
+        breaker_free(s);
+    }
+
+    double elapsed = now() - start;
+    printf("%zu rounds in %.3f s (%.1f rounds/s)\n", rounds, elapsed,
+        rounds / elapsed);
+    if (games_over > 0) {
+        printf("%zu games over, mean score %.2f\n", games_over,
+            (double)total_score / games_over);
+    }
+    return 0;
+}